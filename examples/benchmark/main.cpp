@@ -0,0 +1,472 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "math/vector3.hpp"
+#include "shapes/objloader.hpp"
+#include "scene/scene.hpp"
+#include "scene/scenenode.hpp"
+#include "scene/texture.hpp"
+#include "shapes/cube.hpp"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define FRAMES 100
+#define CLEAR_WIDTH 3840
+#define CLEAR_HEIGHT 2160
+#define TEXTURE_SIZE 1024
+#define TRANSFORM_POINTS 65536
+// shapes scattered around the camera by renderField(), most of them off screen
+#define FIELD_SHAPES 200
+#define FIELD_SIZE 80
+// small cubes drawn by renderInstances(), most of them off screen
+#define INSTANCES 20000
+// vertices along each side of the height field the hierarchies are built over, 2 triangles per cell
+#define HEIGHT_FIELD_SIZE 1025
+
+/**
+ * @brief ways of transforming points compared by transformPoints()
+ * 
+ */
+enum TransformMode {
+	TRANSFORM_SINGLE, // one matrix vector product per point
+	TRANSFORM_BATCHED, // one call with the perspective division
+	TRANSFORM_AFFINE, // one call without the perspective division
+	TRANSFORM_STREAM // one call on an array per coordinate
+};
+
+/**
+ * @brief render a rotating shape several times
+ * 
+ * @return double the median frame time in milliseconds
+ */
+double renderFrames(Scene &scene, Shape &shape, int frames) {
+	std::vector<double> times;
+	float rotation = 0;
+	for (int i = 0; i < frames; i++) {
+		auto start = std::chrono::steady_clock::now();
+		rotation += 0.01;
+
+		scene.clear();
+		scene.pushMatrix();
+		scene.rotate(0, rotation, 0);
+		scene.drawShape(&shape);
+		scene.popMatrix();
+		scene.render();
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	scene.finish();
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * @brief position of a shape of the field, a fixed pseudo random layout
+ * 
+ * @param index the index of the shape, below FIELD_SHAPES
+ * @return Vector3f the translation of the shape
+ */
+Vector3f fieldPosition(int index) {
+	float x = (index * 37 % FIELD_SHAPES) / (float)FIELD_SHAPES - 0.5f;
+	float z = (index * 91 % FIELD_SHAPES) / (float)FIELD_SHAPES - 0.5f;
+	return Vector3f(x * FIELD_SIZE, 0, z * FIELD_SIZE);
+}
+
+/**
+ * @brief render copies of a shape scattered around the camera, in front of and behind it
+ * 
+ * @param graph the copies as the children of a retained scene graph, nullptr to draw them with the matrix stack
+ * @return double the median frame time in milliseconds
+ */
+double renderField(Scene &scene, Shape &shape, SceneNode *graph, int frames) {
+	std::vector<double> times;
+	for (int i = 0; i < frames; i++) {
+		auto start = std::chrono::steady_clock::now();
+
+		scene.clear();
+		if (graph) {
+			scene.drawNode(graph);
+		}
+		for (int j = 0; !graph && j < FIELD_SHAPES; j++) {
+			scene.pushMatrix();
+			scene.translate(fieldPosition(j));
+			scene.drawShape(&shape);
+			scene.popMatrix();
+		}
+		scene.render();
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	scene.finish();
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * @brief render copies of a small shape scattered around the camera
+ * 
+ * @param instanced draw them with one drawInstanced() call instead of the matrix stack
+ * @return double the median frame time in milliseconds
+ */
+double renderInstances(Scene &scene, Shape &shape, bool instanced, int frames) {
+	std::vector<Matrix4> matrices;
+	for (int i = 0; i < INSTANCES; i++) {
+		// a fixed pseudo random layout
+		float x = (i * 37 % INSTANCES) / (float)INSTANCES - 0.5f;
+		float y = (i * 53 % 101) / 101.0f - 0.5f;
+		float z = (i * 91 % INSTANCES) / (float)INSTANCES - 0.5f;
+		matrices.push_back(Matrix4::translation(x * FIELD_SIZE, y * 4, z * FIELD_SIZE) * Matrix4::rotation(0, i, 0));
+	}
+
+	std::vector<double> times;
+	for (int i = 0; i < frames; i++) {
+		auto start = std::chrono::steady_clock::now();
+
+		scene.clear();
+		if (instanced) {
+			scene.drawInstanced(&shape, matrices.data(), matrices.size());
+		}
+		for (int j = 0; !instanced && j < INSTANCES; j++) {
+			Matrix4 matrix = matrices[j];
+			scene.pushMatrix();
+			scene.translate(matrix.at(0, 3), matrix.at(1, 3), matrix.at(2, 3));
+			scene.rotate(0, j, 0);
+			scene.drawShape(&shape);
+			scene.popMatrix();
+		}
+		scene.render();
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	scene.finish();
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * @brief pick the triangles under a grid of pixels of the last rendered frame
+ * 
+ * @return double the average time of a pick in microseconds
+ */
+double pickPixels(Scene &scene, int frames) {
+	const unsigned step = 16;
+	unsigned picks = 0, hits = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames; i++) {
+		for (unsigned y = 0; y < HEIGHT; y += step) {
+			for (unsigned x = 0; x < WIDTH; x += step) {
+				hits += scene.pick(x, y).shape != nullptr;
+				picks++;
+			}
+		}
+	}
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+	// keep the picks from being optimized away
+	if (hits == 1234567) {
+		std::cout << hits << std::endl;
+	}
+	return elapsed.count() / picks;
+}
+
+/**
+ * @brief frame time divided by the pixels written in the last frame
+ * 
+ * @return double the time per written pixel in nanoseconds
+ */
+double pixelTime(double frameTime, const RenderStats &stats) {
+	return stats.writtenPixels ? frameTime * 1e6 / stats.writtenPixels : 0;
+}
+
+/**
+ * @brief sample a texture over a screen sized grid of texture coordinates
+ * 
+ * @param scale texels per screen pixel
+ * @param angle rotation of the grid in the texture, in radians
+ * @param mipmapped read the level matching the scale instead of the full size one
+ * @return double the bilinear texel reads per second, in millions
+ */
+double sampleTexture(const Texture &texture, float scale, float angle, bool mipmapped, int frames) {
+	unsigned level = mipmapped ? texture.selectLevel(scale * scale) : 0;
+	float stepU = std::cos(angle) * scale / texture.getWidth();
+	float stepV = std::sin(angle) * scale / texture.getHeight();
+	uint32_t checksum = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames; i++) {
+		for (int y = 0; y < HEIGHT; y++) {
+			for (int x = 0; x < WIDTH; x++) {
+				checksum += texture.sample(x * stepU - y * stepV, x * stepV + y * stepU, level);
+			}
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	// keep the samples from being optimized away
+	if (checksum == 1) {
+		std::cout << checksum << std::endl;
+	}
+	return 4.0 * WIDTH * HEIGHT * frames / elapsed.count() / 1e6;
+}
+
+/**
+ * @brief transform a batch of points several times
+ * 
+ * @param mode the transformation api to use
+ * @return double the transformed points per second, in millions
+ */
+double transformPoints(TransformMode mode, int frames) {
+	Matrix4 matrix = Matrix4::translation(1, 2, 3) * Matrix4::rotation(0.1, 0.2, 0.3);
+	std::vector<Vector3f> points(TRANSFORM_POINTS), results(TRANSFORM_POINTS);
+	std::vector<float> x(TRANSFORM_POINTS), y(TRANSFORM_POINTS), z(TRANSFORM_POINTS);
+	for (unsigned i = 0; i < TRANSFORM_POINTS; i++) {
+		points[i] = Vector3f(i % 17, i % 13, i % 11);
+		x[i] = points[i].x;
+		y[i] = points[i].y;
+		z[i] = points[i].z;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames; i++) {
+		if (mode == TRANSFORM_SINGLE) {
+			for (unsigned j = 0; j < TRANSFORM_POINTS; j++) {
+				results[j] = matrix * points[j];
+			}
+		} else if (mode == TRANSFORM_STREAM) {
+			matrix.transformPoints(x.data(), y.data(), z.data(), TRANSFORM_POINTS);
+		} else {
+			matrix.transformPoints(points.data(), results.data(), TRANSFORM_POINTS, mode == TRANSFORM_AFFINE);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	// keep the results from being optimized away
+	if (results[1].x == 1234 || x[1] == 1234) {
+		std::cout << results[1] << x[1] << std::endl;
+	}
+	return (double)TRANSFORM_POINTS * frames / elapsed.count() / 1e6;
+}
+
+/**
+ * @brief create a bumpy square grid of triangles
+ * 
+ * @param positions filled with HEIGHT_FIELD_SIZE * HEIGHT_FIELD_SIZE vertices
+ * @param indices filled with 3 vertex indices per triangle
+ */
+void heightField(std::vector<Vector3f> &positions, std::vector<uint32_t> &indices) {
+	for (unsigned y = 0; y < HEIGHT_FIELD_SIZE; y++) {
+		for (unsigned x = 0; x < HEIGHT_FIELD_SIZE; x++) {
+			positions.push_back(Vector3f(x, std::sin(x * 0.05f) * std::cos(y * 0.07f) * 20, y));
+		}
+	}
+	for (unsigned y = 0; y + 1 < HEIGHT_FIELD_SIZE; y++) {
+		for (unsigned x = 0; x + 1 < HEIGHT_FIELD_SIZE; x++) {
+			uint32_t corner = y * HEIGHT_FIELD_SIZE + x;
+			indices.insert(indices.end(), {corner, corner + 1, corner + HEIGHT_FIELD_SIZE});
+			indices.insert(indices.end(), {corner + 1, corner + HEIGHT_FIELD_SIZE + 1, corner + HEIGHT_FIELD_SIZE});
+		}
+	}
+}
+
+/**
+ * @brief build or refit a hierarchy over a mesh several times
+ * 
+ * @param refit refit the tree built by the previous call instead of building a new one
+ * @return double the median time in milliseconds
+ */
+double buildHierarchy(Bvh &bvh, const std::vector<Vector3f> &positions, const std::vector<uint32_t> &indices, bool refit, int frames) {
+	std::vector<double> times;
+	for (int i = 0; i < frames; i++) {
+		auto start = std::chrono::steady_clock::now();
+		if (refit) {
+			bvh.refit(positions.data(), indices.data(), indices.size() / 3);
+		} else {
+			bvh.build(positions.data(), indices.data(), indices.size() / 3);
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * @brief clear a fully drawn framebuffer several times
+ * 
+ * @param lazy use the O(tiles) deferred clear instead of filling every pixel
+ * @return double the median clear time in milliseconds
+ */
+double clearFrames(Framebuffer &framebuffer, bool lazy, int frames) {
+	std::vector<double> times;
+	for (int i = 0; i < frames; i++) {
+		// every tile was drawn in during the previous frame
+		for (unsigned y = 0; y < framebuffer.getTilesY(); y++) {
+			for (unsigned x = 0; x < framebuffer.getTilesX(); x++) {
+				framebuffer.resolveTile(x, y);
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		if (lazy) {
+			framebuffer.clear();
+		} else {
+			framebuffer.fill();
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		times.push_back(elapsed.count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * @brief render the teapot scene offscreen and report the average frame time
+ * 
+ * usage: benchmark [obj file] [frames]
+ */
+int main(int argc, char *argv[]) {
+	std::string fileName = argc > 1 ? argv[1] : "../objLoader/assets/teapot.obj";
+	int frames = argc > 2 ? std::stoi(argv[2]) : FRAMES;
+
+	Scene scene(WIDTH, HEIGHT, 90, 1, 1000);
+	scene.setCamera(Vector3f(0, 4, -3), Vector3f(0, 0, 0), Vector3f(0, 1, 0));
+
+	ObjLoader loader(Vector3f(1.2, 1.2, 1.2));
+	loader.loadObjFile(fileName);
+	if (!loader.isLoaded()) {
+		std::cout << "Error loading file" << std::endl;
+		std::cout << loader.getErrorMessage() << std::endl;
+		std::cout << "At line: " << loader.getErrorLine() << std::endl;
+		return 1;
+	}
+
+	std::cout << "Triangles: " << loader.getMesh()->triangleCount() << ", unique vertices: " << loader.getMesh()->positions.size() << std::endl;
+	std::cout << "Resolution: " << WIDTH << "x" << HEIGHT << ", " << frames << " frames" << std::endl;
+
+	scene.setThreadCount(1);
+	scene.simd = false;
+	std::cout << "Scalar frame time: " << renderFrames(scene, loader, frames) << " ms" << std::endl;
+	scene.simd = true;
+	double flatTime = renderFrames(scene, loader, frames);
+	std::cout << Rasterizer::simdName() << " frame time: " << flatTime << " ms, ";
+	std::cout << pixelTime(flatTime, scene.getStats()) << " ns per written pixel" << std::endl;
+	const unsigned long *sizes = scene.getStats().sizes;
+	std::cout << "Triangle sizes: " << sizes[TRIANGLE_CULLED] << " culled, " << sizes[TRIANGLE_EMPTY] << " empty, ";
+	std::cout << sizes[TRIANGLE_SMALL] << " small, " << sizes[TRIANGLE_MEDIUM] << " medium, " << sizes[TRIANGLE_LARGE] << " large" << std::endl;
+	scene.gouraud = true;
+	double gouraudTime = renderFrames(scene, loader, frames);
+	std::cout << Rasterizer::simdName() << " Gouraud frame time: " << gouraudTime << " ms, ";
+	std::cout << pixelTime(gouraudTime, scene.getStats()) << " ns per written pixel" << std::endl;
+	scene.gouraud = false;
+
+	std::vector<uint8_t> pixels(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+	for (unsigned i = 0; i < pixels.size(); i++) {
+		pixels[i] = (i * 2654435761u) >> 24;
+	}
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>(TEXTURE_SIZE, TEXTURE_SIZE, pixels.data());
+	Cube cube(Vector3f(1.5, 1.5, 1.5));
+	cube.setTexture(texture);
+	double texturedTime = renderFrames(scene, cube, frames);
+	std::cout << Rasterizer::simdName() << " textured cube frame time: " << texturedTime << " ms, ";
+	std::cout << pixelTime(texturedTime, scene.getStats()) << " ns per written pixel" << std::endl;
+	scene.visibility = true;
+	std::cout << Rasterizer::simdName() << " visibility buffer textured cube frame time: " << renderFrames(scene, cube, frames) << " ms" << std::endl;
+	scene.gouraud = true;
+	std::cout << Rasterizer::simdName() << " visibility buffer Gouraud frame time: " << renderFrames(scene, loader, frames) << " ms" << std::endl;
+	scene.gouraud = false;
+	scene.visibility = false;
+	int samplingFrames = std::max(1, frames / 10);
+	std::cout << "Texture sampling, magnified: " << sampleTexture(*texture, 0.5, 0.3, true, samplingFrames) << " Mtexels/s, ";
+	std::cout << "minified 4x: " << sampleTexture(*texture, 4, 0.3, true, samplingFrames) << " Mtexels/s, ";
+	std::cout << "minified 4x without mipmaps: " << sampleTexture(*texture, 4, 0.3, false, samplingFrames) << " Mtexels/s" << std::endl;
+	int transformFrames = frames * 10;
+	std::cout << "Point transform, one by one: " << transformPoints(TRANSFORM_SINGLE, transformFrames) << " Mpoints/s, ";
+	std::cout << "batched: " << transformPoints(TRANSFORM_BATCHED, transformFrames) << " Mpoints/s, ";
+	std::cout << "batched affine: " << transformPoints(TRANSFORM_AFFINE, transformFrames) << " Mpoints/s, ";
+	std::cout << "structure of arrays: " << transformPoints(TRANSFORM_STREAM, transformFrames) << " Mpoints/s" << std::endl;
+
+	scene.hiz = true;
+	std::cout << Rasterizer::simdName() << " with hierarchical z frame time: " << renderFrames(scene, loader, frames) << " ms" << std::endl;
+	const RenderStats &stats = scene.getStats();
+	std::cout << "Early reject rate: " << stats.triangleRejectRate() * 100 << "% of triangles, ";
+	std::cout << stats.blockRejectRate() * 100 << "% of blocks" << std::endl;
+	scene.hiz = false;
+
+	scene.overdraw = true;
+	std::cout << "Overdraw view frame time: " << renderFrames(scene, loader, frames) << " ms, ";
+	std::cout << stats.testedPixels << " pixels tested, " << stats.passedPixels << " passed, ";
+	std::cout << stats.writtenPixels << " written" << std::endl;
+	scene.overdraw = false;
+	scene.pipelined = true;
+	std::cout << Rasterizer::simdName() << " pipelined frame time: " << renderFrames(scene, loader, frames) << " ms" << std::endl;
+	scene.pipelined = false;
+
+	int fieldFrames = std::max(1, frames / 10);
+	scene.culling = false;
+	std::cout << FIELD_SHAPES << " scattered shapes frame time: " << renderField(scene, loader, nullptr, fieldFrames) << " ms, ";
+	scene.culling = true;
+	std::cout << "with frustum culling: " << renderField(scene, loader, nullptr, fieldFrames) << " ms, ";
+	std::cout << stats.culledShapes << " of " << stats.shapes << " shapes culled" << std::endl;
+	scene.lod = false;
+	std::cout << "Without levels of detail: " << renderField(scene, loader, nullptr, fieldFrames) << " ms, ";
+	std::cout << stats.triangles << " triangles, ";
+	scene.lod = true;
+	std::cout << "with levels of detail: " << renderField(scene, loader, nullptr, fieldFrames) << " ms, ";
+	std::cout << stats.triangles << " triangles" << std::endl;
+	scene.hiz = true;
+	scene.overdraw = true;
+	renderField(scene, loader, nullptr, 1);
+	unsigned long submittedWrites = stats.writtenPixels;
+	scene.order = DRAW_FRONT_TO_BACK;
+	renderField(scene, loader, nullptr, 1);
+	unsigned long sortedWrites = stats.writtenPixels;
+	scene.overdraw = false;
+	scene.order = DRAW_SUBMITTED;
+	std::cout << "With hierarchical z, submission order: " << renderField(scene, loader, nullptr, fieldFrames) << " ms, ";
+	std::cout << submittedWrites << " pixels written, ";
+	scene.order = DRAW_FRONT_TO_BACK;
+	std::cout << "front to back: " << renderField(scene, loader, nullptr, fieldFrames) << " ms, ";
+	std::cout << sortedWrites << " pixels written" << std::endl;
+	scene.order = DRAW_SUBMITTED;
+	scene.hiz = false;
+	SceneNode field;
+	for (int i = 0; i < FIELD_SHAPES; i++) {
+		field.addChild(&loader, Matrix4::translation(fieldPosition(i)));
+	}
+	std::cout << "Retained scene graph frame time: " << renderField(scene, loader, &field, fieldFrames) << " ms, ";
+	scene.gouraud = true;
+	std::cout << "Gouraud immediate: " << renderField(scene, loader, nullptr, fieldFrames) << " ms, ";
+	std::cout << "Gouraud retained: " << renderField(scene, loader, &field, fieldFrames) << " ms" << std::endl;
+	scene.gouraud = false;
+	std::cout << "Picking: " << pickPixels(scene, frames) << " us per pixel" << std::endl;
+	Cube smallCube(Vector3f(0.2, 0.2, 0.2));
+	std::cout << INSTANCES << " small cubes frame time: " << renderInstances(scene, smallCube, false, fieldFrames) << " ms, ";
+	std::cout << "instanced: " << renderInstances(scene, smallCube, true, fieldFrames) << " ms" << std::endl;
+
+	std::vector<Vector3f> positions;
+	std::vector<uint32_t> indices;
+	heightField(positions, indices);
+	Bvh bvh;
+	int bvhFrames = std::max(1, frames / 20);
+	std::cout << "Hierarchy over " << indices.size() / 3 << " triangles, build time: " << buildHierarchy(bvh, positions, indices, false, bvhFrames) << " ms, ";
+	std::cout << "refit time: " << buildHierarchy(bvh, positions, indices, true, bvhFrames) << " ms, ";
+	std::cout << bvh.getNodes().size() << " nodes, cost " << bvh.getCost() << std::endl;
+
+	Framebuffer framebuffer(CLEAR_WIDTH, CLEAR_HEIGHT);
+	std::cout << CLEAR_WIDTH << "x" << CLEAR_HEIGHT << " full clear time: " << clearFrames(framebuffer, false, frames) << " ms" << std::endl;
+	std::cout << CLEAR_WIDTH << "x" << CLEAR_HEIGHT << " lazy clear time: " << clearFrames(framebuffer, true, frames) << " ms" << std::endl;
+
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned threads = 2; threads < maxThreads * 2; threads *= 2) {
+		scene.setThreadCount(std::min(threads, maxThreads));
+		std::cout << scene.getThreadCount() << " threads frame time: " << renderFrames(scene, loader, frames) << " ms" << std::endl;
+	}
+
+	return 0;
+}
@@ -5,12 +5,14 @@
 #include "math/vector3.hpp"
 #include "shapes/cube.hpp"
 #include "scene/scene.hpp"
+#include "adapter/sfmlpresenter.hpp"
 
 #define CUBES 4
 
 int main() {
 	sf::RenderWindow window(sf::VideoMode(500, 500), "3D render");
 	Scene scene(500, 500, 90, 1, 1000);
+	SfmlPresenter presenter;
 	scene.wireframe = false;
 	scene.normals = false;
 	scene.faces = true;
@@ -25,20 +27,20 @@ int main() {
 		Vector3f(-65,0,0)
 	};
 
-	sf::Color facesColors[6] = {
-		sf::Color::Red,
-		sf::Color::Blue,
-		sf::Color::Cyan,
-		sf::Color::Magenta,
-		sf::Color::Green,
-		sf::Color::Yellow
+	Color facesColors[6] = {
+		Color::Red,
+		Color::Blue,
+		Color::Cyan,
+		Color::Magenta,
+		Color::Green,
+		Color::Yellow
 	};
 
-	std::vector<Cube> displayCubes(CUBES);
-	for (int i = 0; i < CUBES; i++) {
-		displayCubes.at(i).setSize(25, 25, 25);
-		displayCubes.at(i).setFacesColors(facesColors);
-	}
+	// one cube drawn at each position
+	Cube cube;
+	cube.setSize(25, 25, 25);
+	cube.setFacesColors(facesColors);
+	Matrix4 cubeMatrices[CUBES];
 
 	float rotation = 0;
 	float distance = 250;
@@ -65,6 +67,17 @@ int main() {
 					scene.faces = !scene.faces;
 				} else if (event.key.code == sf::Keyboard::B) {
 					scene.zbuffer = !scene.zbuffer;
+				} else if (event.key.code == sf::Keyboard::G) {
+					scene.gouraud = !scene.gouraud;
+				} else if (event.key.code == sf::Keyboard::O) {
+					scene.overdraw = !scene.overdraw;
+				} else if (event.key.code == sf::Keyboard::V) {
+					scene.visibility = !scene.visibility;
+				}
+			} else if (event.type == sf::Event::MouseButtonPressed && scene.visibility) {
+				unsigned triangle = scene.getTriangleAt(event.mouseButton.x, event.mouseButton.y);
+				if (triangle != NO_TRIANGLE) {
+					std::cout << "Triangle " << triangle << std::endl;
 				}
 			}
 		}
@@ -91,14 +104,12 @@ int main() {
 		scene.clear();
 
 		for (int i = 0; i < CUBES; i++) {
-			scene.pushMatrix();
-			scene.translate(cubePos[i]);
-			scene.rotate(0, cubeRotation, 0);
-			scene.drawShape(&displayCubes[i]);
-			scene.popMatrix();
+			cubeMatrices[i] = Matrix4::translation(cubePos[i]) * Matrix4::rotation(0, cubeRotation, 0);
 		}
+		scene.drawInstanced(&cube, cubeMatrices, CUBES);
 
-		scene.draw(window);
+		scene.render();
+		presenter.draw(scene.getFramebuffer(), window);
 		window.display();
 	}
 
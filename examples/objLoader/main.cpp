@@ -3,10 +3,12 @@
 #include "math/vector3.hpp"
 #include "shapes/objloader.hpp"
 #include "scene/scene.hpp"
+#include "adapter/sfmlpresenter.hpp"
 
 int main() {
 	sf::RenderWindow window(sf::VideoMode(500, 500), "OBJ Loader");
 	Scene scene(500, 500, 90, 1, 1000);
+	SfmlPresenter presenter;
 	scene.wireframe = false;
 	scene.normals = false;
 	scene.normalLength = 0.1;
@@ -29,6 +31,11 @@ int main() {
 	}
 	std::cout << "Object loaded" << std::endl;
 	std::cout << "Triangles: " << loader.getTriangles().size()<<std::endl;
+	std::cout << "Levels of detail:";
+	for (unsigned level = 0; loader.getLevel(level); level++) {
+		std::cout << " " << loader.getLevel(level)->triangleCount();
+	}
+	std::cout << " triangles" << std::endl;
 
 	float rotation = 0, distance = 1;
 	float direction = 0.02;
@@ -37,6 +44,14 @@ int main() {
 		while (window.pollEvent(event)) {
 			if (event.type == sf::Event::Closed) {
                 		window.close();
+			} else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::L) {
+				scene.lod = !scene.lod;
+			} else if (event.type == sf::Event::MouseButtonPressed) {
+				PickResult hit = scene.pick(event.mouseButton.x, event.mouseButton.y);
+				if (hit.shape) {
+					std::cout << "Triangle " << hit.triangle << " at " << hit.position;
+					std::cout << ", barycentric coordinates " << hit.u << " " << hit.v << std::endl;
+				}
 			}
 		}
 
@@ -61,7 +76,8 @@ int main() {
 		scene.popMatrix();
 
 		window.clear();
-		scene.draw(window);
+		scene.render();
+		presenter.draw(scene.getFramebuffer(), window);
 		window.display();
 	}
 
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <vector>
+#include <cstring>
+#include "scene/framebuffer.hpp"
+
+/**
+ * @brief upload a framebuffer to a SFML texture and draw it on a render target
+ * 
+ * this is the only part of the engine that depends on SFML, the scene itself
+ * renders into a plain Framebuffer
+ */
+class SfmlPresenter {
+	public:
+		void draw(const Framebuffer &framebuffer, sf::RenderTarget &target);
+
+	private:
+		sf::Texture texture;
+		sf::Sprite sprite;
+		std::vector<sf::Uint8> packed;
+};
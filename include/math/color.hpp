@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief 8 bit per channel RGBA color, stored in this order in the framebuffer
+ * 
+ */
+class Color {
+	public:
+		Color() : r(0), g(0), b(0), a(255) {};
+		Color(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) : r(r), g(g), b(b), a(a) {};
+
+		bool operator==(const Color& other) const {
+			return r == other.r && g == other.g && b == other.b && a == other.a;
+		}
+
+		bool operator!=(const Color& other) const {
+			return !(*this == other);
+		}
+
+		static const Color Black;
+		static const Color White;
+		static const Color Red;
+		static const Color Green;
+		static const Color Blue;
+		static const Color Yellow;
+		static const Color Magenta;
+		static const Color Cyan;
+		static const Color Transparent;
+
+		uint8_t r, g, b, a;
+};
+
+inline const Color Color::Black(0, 0, 0);
+inline const Color Color::White(255, 255, 255);
+inline const Color Color::Red(255, 0, 0);
+inline const Color Color::Green(0, 255, 0);
+inline const Color Color::Blue(0, 0, 255);
+inline const Color Color::Yellow(255, 255, 0);
+inline const Color Color::Magenta(255, 0, 255);
+inline const Color Color::Cyan(0, 255, 255);
+inline const Color Color::Transparent(0, 0, 0, 0);
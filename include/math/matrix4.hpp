@@ -3,8 +3,19 @@
 #include <cmath>
 #include <stdexcept>
 #include <ostream>
+#include <cstddef>
 #include "math/vector3.hpp"
 
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define MATRIX4_SIMD_WIDTH 8
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define MATRIX4_SIMD_WIDTH 4
+#else
+	#define MATRIX4_SIMD_WIDTH 1
+#endif
+
 class Matrix4 {
 	public:
 		Matrix4();
@@ -17,6 +28,13 @@ class Matrix4 {
 		void setLine(unsigned line, Vector3f vector);
 		void setColumn(unsigned column, Vector3f vector);
 
+		Vector3f transformDirection(const Vector3f &direction) const;
+		bool inverse(Matrix4 &result) const;
+		Matrix4 inverse() const;
+		void transformPoints(const Vector3f *points, Vector3f *results, size_t count, bool affine = false) const;
+		void transformDirections(const Vector3f *directions, Vector3f *results, size_t count) const;
+		void transformPoints(float *x, float *y, float *z, size_t count) const;
+
 		Matrix4& operator*=(const Matrix4& other);
 		Matrix4& operator+=(const Matrix4& other);
 		Matrix4& operator-=(const Matrix4& other);
@@ -28,6 +46,8 @@ class Matrix4 {
 		static Matrix4 rotation(Vector3<float> rotation);
 		static Matrix4 rotation(float anglex, float angley, float anglez);
 
+		friend Vector3f operator*(const Matrix4& left, const Vector3f& right);
+
 	private:
 		float values[16];
 };
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+template <typename T>
+class Vector2 {
+	public:
+		Vector2(): x(0), y(0) {};
+		Vector2(T x, T y) : x(x), y(y) {};
+		Vector2(const Vector2<T>& other) : x(other.x), y(other.y) {};
+
+		Vector2<T>& operator=(const Vector2<T>& other) = default;
+
+		Vector2<T>& operator+=(const Vector2<T>& other) {
+			x += other.x;
+			y += other.y;
+			return *this;
+		}
+
+		Vector2<T>& operator-=(const Vector2<T>& other) {
+			x -= other.x;
+			y -= other.y;
+			return *this;
+		}
+
+		Vector2<T>& operator*=(const T& other) {
+			x *= other;
+			y *= other;
+			return *this;
+		}
+
+		T x, y;
+};
+
+template <typename T>
+Vector2<T> operator+(const Vector2<T>& left, const Vector2<T>& right) {
+	return Vector2<T>(left.x + right.x, left.y + right.y);
+}
+template <typename T>
+Vector2<T> operator-(const Vector2<T>& left, const Vector2<T>& right) {
+	return Vector2<T>(left.x - right.x, left.y - right.y);
+}
+template <typename T>
+Vector2<T> operator*(const Vector2<T>& left, const T& right) {
+	return Vector2<T>(left.x * right, left.y * right);
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const Vector2<T>& vec) {
+	os << "(" << vec.x << ", " << vec.y << ")";
+	return os;
+}
+
+typedef Vector2<float>   Vector2f;
+typedef Vector2<int>     Vector2i;
+typedef Vector2<int64_t> Vector2l;
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include "math/vector3.hpp"
+#include "scene/trianglestream.hpp"
+
+// most primitives a leaf is allowed to keep when splitting it is not worth it
+#define BVH_MAX_LEAF_SIZE 16
+// number of bins the surface area heuristic sorts the centroids into along each axis
+#define BVH_BINS 16
+// deepest level of a leaf, deeper nodes stay leaves so the queries have a bounded stack
+#define BVH_MAX_DEPTH 48
+// cost of visiting a node relative to testing a primitive
+#define BVH_TRAVERSAL_COST 1.0f
+// refit trees whose cost grew above this ratio of their cost once built are rebuilt by update()
+#define BVH_REFIT_LIMIT 2.0f
+
+/**
+ * @brief axis aligned box, empty when its minimum is above its maximum
+ * 
+ */
+struct BoundingBox {
+	Vector3f min, max;
+
+	BoundingBox();
+	BoundingBox(const Vector3f &min, const Vector3f &max);
+
+	void grow(const Vector3f &point);
+	void grow(const BoundingBox &box);
+	bool empty() const;
+	float area() const;
+	Vector3f center() const;
+};
+
+/**
+ * @brief node of a flattened bounding volume hierarchy, 2 nodes fit in a cache line
+ * 
+ */
+struct BvhNode {
+	float min[3];
+	// index of the left child of an inner node, the right one follows it,
+	// or index of the first primitive of a leaf in Bvh::getIndices()
+	uint32_t first;
+	float max[3];
+	// number of primitives of a leaf, 0 for an inner node
+	uint32_t count;
+
+	bool isLeaf() const {
+		return this->count != 0;
+	}
+};
+
+/**
+ * @brief result of a node test during a query
+ * 
+ */
+enum BvhOverlap {
+	BVH_OUTSIDE,
+	BVH_CROSSING,
+	BVH_INSIDE
+};
+
+/**
+ * @brief bounding volume hierarchy over a list of boxes, built with the binned surface area heuristic
+ * 
+ * the nodes are stored in a single aligned array, the root first and the two
+ * children of each inner node next to each other at an even index so they share a
+ * cache line, the primitives of each subtree are consecutive in the index array
+ * 
+ * moving primitives can be refit: the tree keeps its topology and only the
+ * bounds of the nodes are recomputed, bottom up in a single pass
+ */
+class Bvh {
+	public:
+		Bvh();
+
+		void build(const std::vector<BoundingBox> &boxes);
+		void build(const Vector3f *positions, const uint32_t *indices, unsigned triangles);
+		void refit(const std::vector<BoundingBox> &boxes);
+		void refit(const Vector3f *positions, const uint32_t *indices, unsigned triangles);
+		void update(const std::vector<BoundingBox> &boxes);
+		void update(const Vector3f *positions, const uint32_t *indices, unsigned triangles);
+		void clear();
+
+		bool empty() const;
+		unsigned getPrimitiveCount() const;
+		BoundingBox getBounds() const;
+		float getCost() const;
+		const std::vector<BvhNode, AlignedAllocator<BvhNode>> &getNodes() const;
+		const std::vector<uint32_t> &getIndices() const;
+
+		template <typename NodeTest, typename PrimitiveVisitor>
+		void query(NodeTest test, PrimitiveVisitor visit) const;
+		template <typename PrimitiveIntersection>
+		float intersect(const Vector3f &origin, const Vector3f &direction, float minDistance, float maxDistance, PrimitiveIntersection intersection) const;
+
+	private:
+		void computeTriangleBoxes(const Vector3f *positions, const uint32_t *indices, unsigned triangles);
+		void setBounds(BvhNode &node, const BoundingBox &box) const;
+		BoundingBox getBounds(const BvhNode &node) const;
+		inline float rayEntry(const BvhNode &node, const float *origin, const float *inverse, float minDistance, float maxDistance) const;
+		struct SplitBox;
+		bool split(unsigned node, unsigned depth, const SplitBox &centroidBounds, SplitBox *childCentroids);
+		void computeCost();
+
+		std::vector<BvhNode, AlignedAllocator<BvhNode>> nodes;
+		std::vector<uint32_t> indices;
+		// expected cost of a query through the tree and its cost once built
+		float cost, builtCost;
+
+		// box with 4 floats per side so it loads in a SIMD register, the 4th ones are unused
+		struct alignas(16) SplitBox {
+			float min[4], max[4];
+		};
+		// box of each primitive while the tree is built, moved with its index so the splits read the primitives of a node in order
+		std::vector<SplitBox> references;
+		// box of each triangle of the mesh the tree is built or refit over
+		std::vector<BoundingBox> primitiveBoxes;
+};
+
+/**
+ * @brief visit the primitives of the nodes accepted by a test, depth first
+ * 
+ * the primitives of a node the test finds inside are visited without testing its children
+ * 
+ * @param test called with each reached BvhNode, returns its BvhOverlap
+ * @param visit called with the index of each primitive of the accepted nodes
+ */
+template <typename NodeTest, typename PrimitiveVisitor>
+void Bvh::query(NodeTest test, PrimitiveVisitor visit) const {
+	if (this->nodes.empty()) {
+		return;
+	}
+	uint32_t stack[BVH_MAX_DEPTH + 1];
+	unsigned size = 0;
+	stack[size++] = 0;
+	while (size > 0) {
+		const BvhNode *node = &this->nodes[stack[--size]];
+		BvhOverlap overlap = test(*node);
+		if (overlap == BVH_OUTSIDE) {
+			continue;
+		}
+		if (overlap == BVH_INSIDE || node->isLeaf()) {
+			// the first primitive of the leftmost leaf to the last one of the rightmost leaf
+			const BvhNode *left = node, *right = node;
+			while (!left->isLeaf()) {
+				left = &this->nodes[left->first];
+			}
+			while (!right->isLeaf()) {
+				right = &this->nodes[right->first + 1];
+			}
+			for (uint32_t i = left->first; i < right->first + right->count; i++) {
+				visit(this->indices[i]);
+			}
+			continue;
+		}
+		stack[size++] = node->first + 1;
+		stack[size++] = node->first;
+	}
+}
+
+/**
+ * @brief find the nearest primitive hit by a ray
+ * 
+ * the children of each node are visited nearest first and the nodes entered
+ * beyond the nearest hit found so far are skipped, so a query visits about
+ * log2 of the number of primitives nodes
+ * 
+ * @param origin the origin of the ray
+ * @param direction the direction of the ray, distances are counted in its length
+ * @param minDistance hits nearer than this distance are ignored
+ * @param maxDistance hits farther than this distance are ignored
+ * @param intersection called with a primitive index and the distance range a hit must be in,
+ * returns the distance of its hit in the range or any bigger value if it is missed
+ * @return float the distance of the nearest hit, maxDistance if nothing is hit
+ */
+template <typename PrimitiveIntersection>
+float Bvh::intersect(const Vector3f &origin, const Vector3f &direction, float minDistance, float maxDistance, PrimitiveIntersection intersection) const {
+	float nearest = maxDistance;
+	if (this->nodes.empty()) {
+		return nearest;
+	}
+	const float rayOrigin[3] = {origin.x, origin.y, origin.z};
+	const float inverse[3] = {1 / direction.x, 1 / direction.y, 1 / direction.z};
+	if (this->rayEntry(this->nodes[0], rayOrigin, inverse, minDistance, nearest) > nearest) {
+		return nearest;
+	}
+
+	// nodes to visit and the distance at which the ray enters them
+	std::pair<uint32_t, float> stack[BVH_MAX_DEPTH + 1];
+	unsigned size = 0;
+	stack[size++] = {0, minDistance};
+	while (size > 0) {
+		auto [index, entry] = stack[--size];
+		if (entry > nearest) {
+			continue;
+		}
+		const BvhNode &node = this->nodes[index];
+		if (node.isLeaf()) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				nearest = std::min(nearest, intersection(this->indices[i], minDistance, nearest));
+			}
+			continue;
+		}
+		float left = this->rayEntry(this->nodes[node.first], rayOrigin, inverse, minDistance, nearest);
+		float right = this->rayEntry(this->nodes[node.first + 1], rayOrigin, inverse, minDistance, nearest);
+		// the nearest child is pushed last to be visited first
+		std::pair<uint32_t, float> children[2] = {{node.first, left}, {node.first + 1, right}};
+		if (left < right) {
+			std::swap(children[0], children[1]);
+		}
+		for (const std::pair<uint32_t, float> &child : children) {
+			if (child.second <= nearest) {
+				stack[size++] = child;
+			}
+		}
+	}
+	return nearest;
+}
+
+/**
+ * @brief distance at which a ray enters the box of a node, with the slab test
+ * 
+ * @param node the node to test
+ * @param origin the origin of the ray
+ * @param inverse the inverse of each coordinate of the direction of the ray
+ * @param minDistance the start of the ray
+ * @param maxDistance the end of the ray
+ * @return float the entry distance, infinity if the box is missed between the start and the end
+ */
+inline float Bvh::rayEntry(const BvhNode &node, const float *origin, const float *inverse, float minDistance, float maxDistance) const {
+	float entry = minDistance, exit = maxDistance;
+	for (int axis = 0; axis < 3; axis++) {
+		float near = (node.min[axis] - origin[axis]) * inverse[axis];
+		float far = (node.max[axis] - origin[axis]) * inverse[axis];
+		entry = std::max(entry, std::min(near, far));
+		exit = std::min(exit, std::max(near, far));
+	}
+	return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
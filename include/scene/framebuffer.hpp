@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "math/vector2.hpp"
+#include "math/color.hpp"
+
+// size in pixels of the square screen tiles rasterized in parallel and cleared lazily
+#define TILE_SIZE 64
+// id buffer value of the pixels no triangle covers
+#define NO_TRIANGLE 0xffffffff
+
+/**
+ * @brief cpu render target made of a RGBA8 color buffer and a 1/z depth buffer
+ * 
+ * both buffers have height rows of stride pixels, only the first width pixels
+ * of each row are part of the image
+ * 
+ * clear() only marks the tiles holding something else than the clear values,
+ * each marked tile is filled when it is resolved, the buffers must be resolved
+ * before they are read
+ * 
+ * an optional id buffer holds one 32 bit triangle id per pixel, it is cleared
+ * to NO_TRIANGLE with the other buffers
+ */
+class Framebuffer {
+	public:
+		Framebuffer(unsigned width = 0, unsigned height = 0, unsigned stride = 0);
+
+		void resize(unsigned width, unsigned height, unsigned stride = 0);
+		void clear(const Color &color = Color::Transparent, float depth = 0);
+		void fill(const Color &color = Color::Transparent, float depth = 0);
+		void copy(const Framebuffer &other);
+		void resolveTile(unsigned tileX, unsigned tileY);
+		void resolve();
+
+		unsigned getWidth() const;
+		unsigned getHeight() const;
+		unsigned getStride() const;
+		unsigned getTilesX() const;
+		unsigned getTilesY() const;
+
+		uint8_t *getColorBuffer();
+		const uint8_t *getColorBuffer() const;
+		float *getDepthBuffer();
+		const float *getDepthBuffer() const;
+
+		void setIdBuffer(bool enabled);
+		bool hasIdBuffer() const;
+		uint32_t *getIdBuffer();
+		const uint32_t *getIdBuffer() const;
+		void clearTileIds(unsigned tileX, unsigned tileY);
+
+		Color getPixel(unsigned x, unsigned y) const;
+		void setPixel(unsigned x, unsigned y, const Color &color);
+		float getDepth(unsigned x, unsigned y) const;
+		uint32_t getId(unsigned x, unsigned y) const;
+
+		void drawLine(Vector2f from, Vector2f to, const Color &color);
+
+	private:
+		enum TileState : char {
+			TILE_CLEARED, // holds the clear values
+			TILE_DRAWN,   // may have been drawn since the last clear
+			TILE_PENDING  // must be filled with the clear values before it is used
+		};
+
+		void fillTile(unsigned tileX, unsigned tileY);
+
+		unsigned width, height, stride;
+		std::vector<uint8_t> colorBuffer;
+		std::vector<float> depthBuffer;
+		std::vector<uint32_t> idBuffer;
+
+		unsigned tilesX, tilesY;
+		std::vector<TileState> tiles;
+		bool pending;
+		uint32_t clearColor;
+		float clearDepth;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include "math/color.hpp"
+#include "math/matrix4.hpp"
+#include "shapes/triangle.hpp"
+#include "shapes/shape.hpp"
+#include "scene/bvh.hpp"
+#include "scene/trianglesetup.hpp"
+#include "scene/trianglestream.hpp"
+
+/**
+ * @brief a shape drawn in a frame
+ * 
+ */
+struct ShapeInstance {
+	Shape *shape;
+	// world matrix the shape was drawn with
+	Matrix4 matrix;
+	// bounding box of the shape in world space
+	BoundingBox bounds;
+};
+
+/**
+ * @brief the triangles of one frame, from their submission to their rasterization
+ * 
+ * the scene keeps two of them so a frame can be submitted and processed while
+ * the previous one is rasterized
+ */
+struct FrameGeometry {
+	// triangles and colors associated with them, in world space when submitted then in camera space
+	TriangleStream triangles;
+	std::vector<Color> colors;
+	// vertex attributes of each triangle, empty if the whole frame is flat shaded
+	std::vector<TriangleVaryings> varyings;
+	// textures sampled by the varyings, kept alive until the frame is rasterized
+	std::vector<std::shared_ptr<const Texture>> textures;
+	// submission index of each triangle in visibility mode, clipped triangles keep the index of their source
+	std::vector<unsigned> sources;
+	// index of the first triangle of each submitted shape, the depth ordering does not mix the triangles of 2 shapes in a cluster
+	std::vector<unsigned> shapeStarts;
+
+	// triangles set up for rasterization and the triangles touching each tile in submission order
+	std::vector<TriangleSetup> setups;
+	std::vector<char> rasterizable;
+	std::vector<std::vector<unsigned>> tiles;
+
+	// shapes submitted and shapes rejected by their bounding volumes
+	unsigned shapes = 0, culledShapes = 0;
+	// submitted shapes having at least one vertex, culled or not
+	std::vector<ShapeInstance> instances;
+
+	// the framebuffer must be cleared before this frame is drawn
+	bool cleared = false;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include "math/color.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include "scene/trianglesetup.hpp"
+#include "scene/texture.hpp"
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define RASTERIZER_SIMD_WIDTH 8
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define RASTERIZER_SIMD_WIDTH 4
+#else
+	#define RASTERIZER_SIMD_WIDTH 1
+#endif
+
+// longest row segment walked by the simd kernel with 32 bit edge values
+#define RASTERIZER_SEGMENT 64
+
+/**
+ * @brief pixel kernels that fill a set up triangle into color and depth buffers
+ * 
+ * the scalar kernels are the reference implementation, the simd kernels evaluate
+ * RASTERIZER_SIMD_WIDTH pixels at once and write them through a coverage mask,
+ * all return the number of pixels that passed the depth test
+ * 
+ * coverage is computed with exact integer edge functions so both kernels cover
+ * the same pixels and triangles sharing an edge never draw a pixel twice
+ * 
+ * the flat kernels write one color, the smooth kernels write the perspective
+ * correct interpolation of the triangle varyings and the textured kernels sample
+ * the triangle texture at the interpolated coordinates
+ * 
+ * the id kernels write a triangle id instead of a color, shadeSpan() then
+ * shades the pixels the depth test kept, once each
+ * 
+ * the counted kernels are scalar kernels that also count the depth tests and
+ * the writes of each pixel, for the overdraw view
+ */
+class Rasterizer {
+	public:
+		static unsigned drawScalar(const TriangleSetup &setup, const Color &color, uint8_t *pixels, float *zBuffer, unsigned stride);
+		static unsigned drawSIMD(const TriangleSetup &setup, const Color &color, uint8_t *pixels, float *zBuffer, unsigned stride);
+		static unsigned drawSmoothScalar(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride);
+		static unsigned drawSmoothSIMD(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride);
+		static unsigned drawTexturedScalar(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride);
+		static unsigned drawTexturedSIMD(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride);
+		static unsigned drawIdScalar(const TriangleSetup &setup, uint32_t id, uint32_t *ids, float *zBuffer, unsigned stride);
+		static unsigned drawIdSIMD(const TriangleSetup &setup, uint32_t id, uint32_t *ids, float *zBuffer, unsigned stride);
+
+		static unsigned drawCounted(const TriangleSetup &setup, const Color &color, uint8_t *pixels, float *zBuffer, uint32_t *tests, uint32_t *writes, unsigned stride);
+		static unsigned drawIdCounted(const TriangleSetup &setup, uint32_t id, uint32_t *ids, float *zBuffer, uint32_t *tests, unsigned stride);
+
+		static void shadeSpan(const TriangleSetup &setup, const Color &color, int y, int minX, int maxX, const float *zBuffer, uint8_t *pixels, unsigned stride);
+
+		static float farthestDepthScalar(const float *zBuffer, unsigned stride, int minX, int maxX, int minY, int maxY);
+		static float farthestDepth(const float *zBuffer, unsigned stride, int minX, int maxX, int minY, int maxY);
+
+		static const char *simdName();
+	
+		static int32_t clampEdge(int64_t value);
+		static void rowSpan(const TriangleSetup &setup, int y, int &minX, int &maxX);
+		static uint32_t packColor(const Color &color);
+
+	private:
+		template <typename Shader>
+		static unsigned rasterizeScalar(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, unsigned stride);
+		template <typename Shader>
+		static unsigned rasterizeSIMD(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, unsigned stride);
+		template <typename Shader>
+		static unsigned rasterizeCounted(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, uint32_t *tests, uint32_t *writes, unsigned stride);
+		template <typename Shader>
+		static void shadeRow(Shader &shader, int y, int minX, int maxX, const float *zBuffer, uint8_t *pixels, unsigned stride);
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "scene/trianglesetup.hpp"
+
+/**
+ * @brief counters gathered while rasterizing a frame
+ * 
+ */
+struct RenderStats {
+	RenderStats();
+
+	RenderStats& operator+=(const RenderStats& other);
+
+	float triangleRejectRate() const;
+	float blockRejectRate() const;
+
+	// triangle and tile pairs sent to rasterization and rejected by the tile depth
+	unsigned long triangles, rejectedTriangles;
+	// 8x8 blocks tested and rejected by the block depth
+	unsigned long blocks, rejectedBlocks;
+	// covered pixels depth tested, only counted when the overdraw view is on
+	unsigned long testedPixels;
+	// pixels that passed the depth test, and color buffer writes, fewer in visibility mode
+	unsigned long passedPixels, writtenPixels;
+	// set up triangles of each size class
+	unsigned long sizes[TRIANGLE_SIZE_COUNT];
+	// shapes submitted and shapes rejected by their bounding volumes
+	unsigned long shapes, culledShapes;
+};
@@ -1,19 +1,135 @@
 #pragma once
 
-#include <SFML/Graphics/RenderTarget.hpp>
-#include <SFML/Graphics/Color.hpp>
-#include <SFML/Graphics/VertexArray.hpp>
-#include <SFML/Graphics/Texture.hpp>
-#include <SFML/Graphics/Sprite.hpp>
-#include <SFML/System/Vector2.hpp>
 #include <vector>
 #include <stack>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
 #include <stdexcept>
 #include <limits>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <functional>
+#include "math/vector2.hpp"
 #include "math/vector3.hpp"
 #include "math/matrix4.hpp"
+#include "math/color.hpp"
 #include "shapes/shape.hpp"
+#include "shapes/mesh.hpp"
+#include "scene/framebuffer.hpp"
+#include "scene/framegeometry.hpp"
+#include "scene/trianglesetup.hpp"
+#include "scene/rasterizer.hpp"
+#include "scene/threadpool.hpp"
+#include "scene/renderstats.hpp"
+#include "scene/bvh.hpp"
+#include "scene/scenenode.hpp"
+
+// size in pixels of the square blocks of the hierarchical z-buffer, must divide TILE_SIZE
+// with at most 64 blocks in a tile, one bit each in the mask of the blocks to update
+#define HIZ_BLOCK_SIZE 8
+// triangles drawn in a tile before the depth of the blocks they wrote is computed again
+#define HIZ_UPDATE_BATCH 16
+// distance in pixels from the screen borders to the guard band planes, triangles
+// between them are rasterized without being clipped to the sides of the screen
+#define GUARD_BAND 8192
+
+// squared sine of the angle under which a triangle must be seen from behind to be culled before
+// the clipper, the triangles seen almost edge on are left to its camera space test
+#define BACKFACE_MARGIN 1e-6f
+
+// depth tests of a pixel shown with the hottest color of the overdraw view
+#define OVERDRAW_MAX 8
+
+// most consecutive triangles of a shape kept together by the depth ordering
+#define SORT_CLUSTER_SIZE 64
+// bits of the quantized depth the clusters are sorted by, one radix pass per 8 bits
+#define SORT_KEY_BITS 16
+
+// largest error in pixels of the level of detail a mesh is drawn with
+#define LOD_PIXEL_ERROR 0.5f
+// a mesh keeps its level until the error of the level is this factor away from LOD_PIXEL_ERROR,
+// so the meshes near a switch distance do not alternate between 2 levels
+#define LOD_HYSTERESIS 1.5f
+
+/**
+ * @brief shape instance whose level of detail is kept between frames: a scene node, or
+ * a shape drawn out of the scene graph and the number of its copies drawn before it in the frame
+ * 
+ */
+struct LevelKey {
+	const void *owner;
+	unsigned copy;
+
+	bool operator==(const LevelKey &other) const {
+		return this->owner == other.owner && this->copy == other.copy;
+	}
+};
+
+struct LevelKeyHash {
+	size_t operator()(const LevelKey &key) const {
+		return std::hash<const void*>()(key.owner) ^ (size_t)key.copy * 0x9e3779b97f4a7c15ull;
+	}
+};
+
+/**
+ * @brief camera space planes used by the clipper, the bit of a plane in an outcode is 1 << its index
+ * 
+ */
+enum ClipPlane {
+	CLIP_NEAR,
+	CLIP_FAR,
+	// guard band sides, triangles crossing them are clipped
+	CLIP_GUARD_LEFT,
+	CLIP_GUARD_RIGHT,
+	CLIP_GUARD_TOP,
+	CLIP_GUARD_BOTTOM,
+	// screen sides, triangles entirely outside one of them are rejected
+	CLIP_SCREEN_LEFT,
+	CLIP_SCREEN_RIGHT,
+	CLIP_SCREEN_TOP,
+	CLIP_SCREEN_BOTTOM,
+	CLIP_PLANES
+};
+
+// planes a triangle or a whole shape is rejected by when it is entirely outside one of them
+#define CLIP_REJECT_PLANES ((1 << CLIP_NEAR) | (1 << CLIP_FAR) | (0xf << CLIP_SCREEN_LEFT))
+
+/**
+ * @brief order the submitted triangles are rasterized in
+ * 
+ */
+enum DrawOrder {
+	// submission order
+	DRAW_SUBMITTED,
+	// nearest clusters first, so the depth test rejects most hidden pixels before they are written
+	DRAW_FRONT_TO_BACK,
+	// farthest clusters first, the order blended triangles are drawn in
+	DRAW_BACK_TO_FRONT
+};
+
+/**
+ * @brief the nearest triangle under a pixel found by Scene::pick
+ * 
+ */
+struct PickResult {
+	// the hit shape, nullptr if the ray hits nothing
+	Shape *shape = nullptr;
+	// index of the hit shape in Scene::getInstances()
+	unsigned instance = 0;
+	// index of the triangle in the shape mesh, or in its triangle list if it has no mesh
+	unsigned triangle = NO_TRIANGLE;
+	// barycentric coordinates of the hit point, the weights of the second and third vertices
+	float u = 0, v = 0;
+	// distance from the camera and hit point in world space
+	float distance = 0;
+	Vector3f position;
+};
 
 class Scene {
 	public:
@@ -22,9 +138,12 @@ class Scene {
 
 		void resize(unsigned width, unsigned height);
 		void setFov(float fov);
+		void setThreadCount(unsigned threads);
+		unsigned getThreadCount() const;
 
 		void setCamera(const Vector3f position, const Vector3f lookat, const Vector3f up);
 		void setCamera(const Vector3f position, const float theta, const float phi, const Vector3f up);
+		void setLight(const Vector3f direction, float ambient);
 
 		void popMatrix();
 		void pushMatrix();
@@ -34,62 +153,177 @@ class Scene {
 		void rotate(float x, float y, float z);
 
 		void clear();
-		void draw(sf::RenderTarget& target);
-		
+		void render();
+		void finish();
+		const Framebuffer &getFramebuffer() const;
 		
 		void drawShape(Shape *shape);
-		void rasterizeTriangle(const Triangle &t, const sf::Color& color);
+		void drawInstanced(Shape *shape, const Matrix4 *matrices, unsigned count);
+		void drawNode(SceneNode *node);
+		void rasterizeTriangle(const Triangle &t, const Color& color);
 
 		std::tuple<float, float> getZbound() const;
+		const RenderStats &getStats() const;
+		unsigned getTriangleAt(unsigned x, unsigned y) const;
+		unsigned getDepthTests(unsigned x, unsigned y) const;
+		unsigned getPixelWrites(unsigned x, unsigned y) const;
+		const std::vector<ShapeInstance> &getInstances() const;
+		const Bvh &getInstanceBvh();
+		PickResult pick(unsigned x, unsigned y);
 
 		bool wireframe;
 		bool normals;
 		bool faces;
 		bool zbuffer;
+		// count the depth tests and the writes of each pixel and show the tests as a heatmap
+		bool overdraw;
+		bool simd;
+		bool hiz;
+		// reject the shapes whose bounding volumes are outside the view frustum before their triangles are copied,
+		// the parts of the meshes outside it with their hierarchy and the back facing triangles in the space
+		// of each shape, the camera must be set before the shapes are drawn
+		bool culling;
+		// light the submitted shapes per vertex and interpolate the colors or the texture light across triangles
+		bool gouraud;
+		// rasterize only the depth and the triangle ids then shade each visible pixel once,
+		// getTriangleAt() reads the ids
+		bool visibility;
+		// rasterize each frame in the background while the next one is submitted,
+		// the mode flags must not change until finish() once a frame is rendered
+		bool pipelined;
+		// draw the meshes with their coarsest level of detail whose error stays under LOD_PIXEL_ERROR on screen,
+		// the shapes drawn out of the scene graph keep their level between frames while each one is drawn
+		// after the same number of copies of its shape
+		bool lod;
+		// sort the shapes, and the clusters of SORT_CLUSTER_SIZE consecutive triangles of each shape,
+		// by camera space depth before they are clipped, a cluster keeps the order of its triangles
+		DrawOrder order;
 		float normalLength;
 	
 	private:
 		void initPixelsBuffers();
-		inline bool isVisible(const Triangle &triangle) const;
+		void processGeometry();
+		void sortTriangles();
 		void drawFaces();
+		void rasterize();
+		void rasterWorker();
+		ThreadPool &getGeometryPool();
+		void clearFramebuffer(Framebuffer &target);
+		void resizePresentedFramebuffer();
+		void collectStats();
+		void binTriangles();
+		void rasterizeTile(unsigned tile);
+		void rasterizeBlocks(TriangleSetup setup, unsigned index, RenderStats &stats, uint64_t &dirtyBlocks);
+		void shadeTile(unsigned tile);
+		bool isOutsideFrustum(const ShapeBounds &bounds, const Matrix4 &matrix) const;
+		bool isOutsideFrustum(const BoundingBox &box) const;
+		bool areOutsideFrustum(Vector3f *corners, const Matrix4 &toCamera) const;
+		bool cullMesh(const Mesh &mesh);
+		float pickShape(Shape *shape, const Vector3f &origin, const Vector3f &direction, float minDistance, float maxDistance, PickResult &result) const;
+		bool addInstance(Shape *shape, const ShapeBounds &bounds, const Matrix4 &matrix);
+		bool getShapeEye(Vector3f &eye) const;
+		unsigned countCopies(Shape *shape, unsigned count);
+		const Mesh *selectLevel(Shape *shape, const ShapeBounds &bounds, const Matrix4 &matrix, const LevelKey &key);
+		void submitShape(Shape *shape, const Mesh *mesh, bool cull);
+		void drawTriangles(const std::vector<Triangle> &triangles, const std::vector<Color> &colors, const std::vector<std::shared_ptr<const Texture>> &textures, const Vector3f *eye);
+		void drawMesh(const Mesh &mesh, const Vector3f *eye);
+		void drawCachedShape(SceneNode *node);
+		void cacheShape(SceneNode *node, const Mesh *mesh);
+		bool beginShape(unsigned triangles, unsigned colors, unsigned textures);
+		void addTexture(const std::shared_ptr<const Texture> &texture);
+		float lightIntensity(const Vector3f &normal) const;
+		void lightTriangle(const float *intensities, const Vector2f *uvs, const Color &color, const Texture *texture, TriangleVaryings &varyings) const;
+		void updateBlockDepth(unsigned blockX, unsigned blockY);
+		void updateTileDepth(unsigned tile, uint64_t dirtyBlocks);
+		unsigned drawSetup(const TriangleSetup &setup, const Color &color, Framebuffer &target);
+		unsigned drawTriangle(const TriangleSetup &setup, unsigned index);
 		void drawZBuffer();
-		sf::VertexArray drawWireframe() const;
-		sf::VertexArray drawNormals() const;
+		void resetOverdraw();
+		void drawOverdraw();
+		void drawWireframe();
+		void drawNormals();
 		
-		void setTrianglePosFromCamera(Triangle &triangle) const;
-		sf::Vector2f getProjection(Vector3f vector) const;
-		void clipAgainstPlane(const Vector3f &planeNormal, const float &planeD);
-		void clipTriangle(
-			const Triangle &triangle, const sf::Color &color,
-			const Vector3f &planeNormal, const float &planeD,
-			std::vector<Triangle> &renderTriangles, std::vector<sf::Color> &renderColors
-		) const;
+		Vector2f getProjection(Vector3f vector) const;
+		bool getFixedProjection(const Vector3f &vector, Vector2l &snapped) const;
+		void computeClipPlanes();
+		void clipTriangles();
+		void clipTriangle(const FrameGeometry &geometry, unsigned index, unsigned planes, FrameGeometry &clipped) const;
 
-		float computeZIndex(float w1, float w2, float w3, Vector3f v1, Vector3f v2, Vector3f v3);
+		bool setupTriangle(const Vector3f *vertices, const TriangleVaryings *varyings, TriangleSetup &setup) const;
 
 		void computeProjectionMatrix();
 		void computeCameraLookAt();
 		
-		float edgeFunction(const sf::Vector2f &p1, const sf::Vector2f &p2, const sf::Vector2f &p3) const;
+		int64_t edgeFunction(const Vector2l &p1, const Vector2l &p2, const Vector2l &p3) const;
 
 		unsigned int width, height;
 		float fov, near, far;
 		Matrix4 projectionMatrix;
+		// plane equations a * x + b * y + c * z + d >= 0 of the inside of each ClipPlane
+		float clipPlanes[CLIP_PLANES][4];
 
 		Vector3f cameraPosition, cameraLookAt, cameraUp;
+		Vector3f lightDirection;
+		float ambient;
+		// incremented each time the light changes, the cached node triangles lit with an older one are built again
+		unsigned lightRevision;
 		Matrix4 cameraLookAtMatrix;
 
 		std::stack<Matrix4> transformations;
 		Matrix4 worldStateMatrix;
 
-		// triangles and colors associated with them
-		std::vector <Triangle> triangles;
-		std::vector <sf::Color> colors;
+		// post-transform vertex cache of the mesh being submitted: world space positions,
+		// normals and light intensity of each unique vertex, a negative intensity is unknown
+		std::vector<Vector3f> vertexPositions, vertexNormals;
+		std::vector<float> vertexLight;
+		// triangles of the mesh being submitted left by the hierarchical culling
+		std::vector<char> visibleTriangles;
+		// triangles of the node being submitted left by the back face culling
+		std::vector<uint32_t> selectedTriangles;
+		// shape and level of detail of each shape instance submitted to the frame and to the previous one
+		std::unordered_map<LevelKey, std::pair<Shape*, unsigned>, LevelKeyHash> shapeLevels, lastShapeLevels;
+		// copies of each shape with levels of detail drawn out of the scene graph so far in the frame
+		std::unordered_map<Shape*, unsigned> shapeCopies;
 
-		// draw buffer
-		sf::Uint8 *pixels;
-		sf::Texture texture;
-		sf::Sprite sprite;
-		float *zBuffer;
+		// the frame being submitted and the frame being rasterized
+		FrameGeometry geometry, rasterGeometry;
+		// lists the shape of a node is submitted to before they are moved to its cache
+		FrameGeometry nodeGeometry;
+		// hierarchy over the shape instances of the last rendered frame, updated when it is requested
+		Bvh instanceBvh;
+		std::vector<BoundingBox> instanceBoxes;
+		bool instanceBvhValid;
+		// output of the clipper, swapped with the submitted lists
+		FrameGeometry clippedGeometry;
+		// first triangle of each cluster of the frame and its depth, the sorted clusters and the triangles in their order
+		std::vector<uint32_t> clusterStarts;
+		std::vector<float> clusterDepths;
+		std::vector<uint64_t> sortKeys, sortScratch;
+		std::vector<uint32_t> sortedTriangles;
+		// planes each triangle of the clipped frame is entirely outside of and planes it crosses, one bit per ClipPlane
+		std::vector<uint32_t> outsideCodes, crossedCodes;
+		// thread rasterizing the pipelined frames, started with the first one and kept until the scene is destroyed
+		std::thread rasterThread;
+		std::mutex rasterMutex;
+		std::condition_variable rasterCondition;
+		// a frame was handed to the raster thread and not finished yet, it is still being rasterized, the thread must exit
+		bool rasterPending, rasterRunning, rasterStopping;
+
+		// render target and the last finished frame in pipelined mode
+		Framebuffer framebuffer, presentedFramebuffer;
 		float minZ, maxZ;
+
+		std::unique_ptr<ThreadPool> pool;
+		// sets up the triangles of a pipelined frame while the previous one is rasterized on the pool
+		std::unique_ptr<ThreadPool> geometryPool;
+		unsigned tilesX, tilesY;
+
+		// farthest depth of each z-buffer block and each tile, used to reject hidden triangles early
+		std::vector<float> blockDepth, tileDepth;
+		unsigned blocksX, blocksY;
+		std::vector<RenderStats> tileStats;
+		RenderStats stats;
+
+		// depth tests and writes of each pixel in the overdraw view, rows are the framebuffer stride apart
+		std::vector<uint32_t> depthTests, pixelWrites;
 };
\ No newline at end of file
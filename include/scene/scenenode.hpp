@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "math/color.hpp"
+#include "math/matrix4.hpp"
+#include "shapes/shape.hpp"
+#include "scene/bvh.hpp"
+#include "scene/texture.hpp"
+#include "scene/trianglesetup.hpp"
+#include "scene/trianglestream.hpp"
+
+/**
+ * @brief world space triangles of a node, kept between frames by Scene::drawNode
+ * 
+ */
+struct NodeGeometry {
+	// triangles in world space and their colors
+	TriangleStream triangles;
+	std::vector<Color> colors;
+	// x, y and z of (v2 - v1) x (v3 - v1) of each triangle in world space, to cull the back facing ones before they are copied
+	AlignedFloats normals[3];
+	// vertex attributes of each triangle, empty if the shape is flat shaded
+	std::vector<TriangleVaryings> varyings;
+	// textures sampled by the varyings
+	std::vector<std::shared_ptr<const Texture>> textures;
+	// bounding box of the triangles in world space
+	BoundingBox bounds;
+
+	// the triangles match the world matrix of the node, they are built again when it moves
+	bool valid = false;
+	// revision of the shape and of the scene light, shading mode and level of detail the triangles were built with
+	unsigned shapeRevision = 0, lightRevision = 0;
+	bool gouraud = false;
+	const Mesh *mesh = nullptr;
+};
+
+/**
+ * @brief node of a retained scene graph: a shape, or none, placed by a transform relative to its parent
+ * 
+ * the world matrix of a node is computed again only when its transform or the
+ * transform of one of its parents changed: a change marks the whole subtree dirty,
+ * the nodes keep the triangles of their shape in world space until they move
+ */
+class SceneNode {
+	public:
+		SceneNode(Shape *shape = nullptr, const Matrix4 &transform = Matrix4::identity());
+		SceneNode(const SceneNode &other) = delete;
+		SceneNode &operator=(const SceneNode &other) = delete;
+
+		SceneNode *addChild(Shape *shape = nullptr, const Matrix4 &transform = Matrix4::identity());
+		void removeChild(SceneNode *child);
+		SceneNode *getParent() const;
+		const std::vector<std::unique_ptr<SceneNode>> &getChildren() const;
+
+		void setShape(Shape *shape);
+		Shape *getShape() const;
+		void setTransform(const Matrix4 &transform);
+		const Matrix4 &getTransform() const;
+		const Matrix4 &getWorldMatrix();
+		bool isDirty() const;
+
+		// cached world space triangles of the shape, filled by Scene::drawNode
+		NodeGeometry geometry;
+
+	private:
+		void setDirty();
+
+		Shape *shape;
+		// transform relative to the parent and product of the transforms from the root
+		Matrix4 transform, worldMatrix;
+		// the world matrix must be computed again
+		bool dirty;
+		SceneNode *parent;
+		std::vector<std::unique_ptr<SceneNode>> children;
+};
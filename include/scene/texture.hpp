@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// biggest supported image width and height, so texel offsets fit in 32 bits
+#define TEXTURE_MAX_SIZE 16384
+
+/**
+ * @brief RGBA8 texture with a precomputed mip chain, sampled with repeat wrapping
+ * 
+ * the texture is resampled to power of two sizes so texel addresses wrap with a mask,
+ * each level halves the previous one down to 1x1
+ * 
+ * texels of a level are stored in Morton (Z) order: the bits of x and y are interleaved
+ * so texels close in both directions are close in memory and a minified or rotated
+ * footprint touches few cache lines, the interleaved offsets of each column and row
+ * are precomputed so an address is two table loads and an or
+ */
+class Texture {
+	public:
+		Texture();
+		Texture(unsigned width, unsigned height, const uint8_t *pixels);
+
+		void create(unsigned width, unsigned height, const uint8_t *pixels);
+		void loadFromFile(const std::string &fileName);
+
+		unsigned getWidth() const;
+		unsigned getHeight() const;
+		unsigned getLevelCount() const;
+
+		inline uint32_t getTexel(unsigned level, unsigned x, unsigned y) const;
+		inline unsigned selectLevel(float footprint) const;
+		inline uint32_t sample(float u, float v, unsigned level) const;
+
+	private:
+		struct Level {
+			unsigned width, height;
+			// offsets of the level in texels, mortonX and mortonY
+			unsigned offset, xOffset, yOffset;
+		};
+
+		void addLevel(const std::vector<uint32_t> &image, unsigned width, unsigned height);
+		void readPPM(std::ifstream &file, std::vector<uint8_t> &pixels, unsigned &width, unsigned &height);
+		void readTGA(std::ifstream &file, std::vector<uint8_t> &pixels, unsigned &width, unsigned &height);
+
+		std::vector<uint32_t> texels;
+		std::vector<uint32_t> mortonX, mortonY;
+		std::vector<Level> levels;
+};
+
+/**
+ * @brief read a texel, the coordinates wrap around the level size
+ * 
+ * @param level the mip level, 0 is the full size texture
+ * @param x the texel column
+ * @param y the texel row, 0 is the top of the image
+ * @return uint32_t the texel in the RGBA byte order of the framebuffer
+ */
+inline uint32_t Texture::getTexel(unsigned level, unsigned x, unsigned y) const {
+	const Level &l = this->levels[level];
+	x &= l.width - 1;
+	y &= l.height - 1;
+	return this->texels[l.offset + this->mortonX[l.xOffset + x] + this->mortonY[l.yOffset + y]];
+}
+
+/**
+ * @brief choose the nearest mip level for a pixel footprint
+ * 
+ * the level is round(log2(footprint) / 2), computed from the float exponent
+ * 
+ * @param footprint the squared length of the biggest pixel derivative of the texture coordinates, in texels
+ * @return unsigned the mip level
+ */
+inline unsigned Texture::selectLevel(float footprint) const {
+	if (!(footprint >= 0.5f)) {
+		return 0;
+	}
+	if (!(footprint < 1e30f)) {
+		return this->levels.size() - 1;
+	}
+	unsigned level = std::ilogb(footprint * 2) >> 1;
+	return std::min<unsigned>(level, this->levels.size() - 1);
+}
+
+/**
+ * @brief bilinear filtering of a level with repeat wrapping
+ * 
+ * @param u the horizontal texture coordinate, 0 and 1 are the left and right borders
+ * @param v the vertical texture coordinate, 0 and 1 are the top and bottom borders
+ * @param level the mip level to read
+ * @return uint32_t the filtered color in the RGBA byte order of the framebuffer
+ */
+inline uint32_t Texture::sample(float u, float v, unsigned level) const {
+	const Level &l = this->levels[level];
+	// keep big coordinates in the int range, the texture repeats anyway
+	float x = (u - std::floor(u)) * l.width - 0.5f;
+	float y = (v - std::floor(v)) * l.height - 0.5f;
+	float floorX = std::floor(x);
+	float floorY = std::floor(y);
+	int x0 = floorX;
+	int y0 = floorY;
+	uint32_t weightX = (x - floorX) * 256;
+	uint32_t weightY = (y - floorY) * 256;
+
+	uint32_t t00 = this->getTexel(level, x0, y0);
+	uint32_t t10 = this->getTexel(level, x0 + 1, y0);
+	uint32_t t01 = this->getTexel(level, x0, y0 + 1);
+	uint32_t t11 = this->getTexel(level, x0 + 1, y0 + 1);
+
+	// blend two channels at once, each in its own 16 bit half
+	auto lerp = [](uint32_t a, uint32_t b, uint32_t weight) {
+		uint32_t rb = ((a & 0xff00ff) * (256 - weight) + (b & 0xff00ff) * weight) >> 8;
+		uint32_t ga = ((a >> 8) & 0xff00ff) * (256 - weight) + ((b >> 8) & 0xff00ff) * weight;
+		return (rb & 0xff00ff) | (ga & 0xff00ff00);
+	};
+	return lerp(lerp(t00, t10, weightX), lerp(t01, t11, weightX), weightY);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief fixed set of worker threads running parallel for loops
+ * 
+ * the calling thread takes part in the work, so a pool of one thread runs
+ * everything on the caller without any synchronisation
+ */
+class ThreadPool {
+	public:
+		ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		unsigned getThreadCount() const;
+		void run(unsigned tasks, const std::function<void(unsigned)> &task);
+
+	private:
+		void worker();
+		void runTasks();
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable startCondition, doneCondition;
+
+		const std::function<void(unsigned)> *task;
+		unsigned taskCount;
+		std::atomic<unsigned> nextTask;
+		unsigned activeWorkers;
+		unsigned long generation;
+		bool stopping;
+};
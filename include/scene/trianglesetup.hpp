@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include "scene/texture.hpp"
+
+// projected vertices are snapped to 1/SUBPIXEL_SCALE of a pixel
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_SCALE (1 << SUBPIXEL_BITS)
+// number of float attributes interpolated across a triangle
+#define VARYING_COUNT 3
+// biggest bounding box area in pixels of a small triangle
+#define SMALL_TRIANGLE_AREA 16
+// smallest bounding box width in pixels of a large triangle
+#define LARGE_TRIANGLE_WIDTH 32
+
+/**
+ * @brief size classes of the projected triangles, each one is drawn by its own path
+ * 
+ */
+enum TriangleSize : char {
+	TRIANGLE_CULLED, // back facing, degenerated or outside the render area
+	TRIANGLE_EMPTY,  // small and covering no pixel center, rejected at setup
+	TRIANGLE_SMALL,  // point sampled over its few pixels by the scalar kernel
+	TRIANGLE_MEDIUM, // walked over its bounding box by the selected kernel
+	TRIANGLE_LARGE,  // each row is walked over the span between its edges only
+	TRIANGLE_SIZE_COUNT
+};
+
+/**
+ * @brief the attributes of the three vertices of a triangle, for Gouraud shading
+ * they are the lit red, green and blue channels in [0, 255], for a textured
+ * triangle they are the texture coordinates u, v and the light intensity in [0, 1]
+ */
+struct TriangleVaryings {
+	float values[3][VARYING_COUNT];
+	const Texture *texture;
+};
+
+/**
+ * @brief constants of a projected triangle computed once before rasterization
+ * 
+ * each edge function, the depth and the varyings divided by z are affine in screen space so they are stored
+ * as planes f(x, y) = a * x + b * y + c of the pixel coordinates and evaluated at
+ * pixel centers so they can be stepped incrementally
+ */
+struct TriangleSetup {
+	// exact fixed point edge functions, edge i is opposite to vertex i
+	// a pixel is covered when all three are >= 0, the top-left fill rule is folded in c
+	int64_t edgeA[3], edgeB[3], edgeC[3];
+	// true if the x steps are small enough to walk a row segment in 32 bit integers
+	bool narrowSteps;
+	// 1/z plane used for depth testing
+	float depthA, depthB, depthC;
+	// varying/z planes, dividing them by the 1/z plane gives the perspective correct varyings
+	float varyingA[VARYING_COUNT], varyingB[VARYING_COUNT], varyingC[VARYING_COUNT];
+	// true if the varyings are set and used as the pixel color
+	bool smooth;
+	// texture sampled with the varyings, nullptr if the triangle is not textured
+	const Texture *texture;
+	// smallest and biggest 1/z of the triangle vertices
+	float minDepth, maxDepth;
+	// bounding box clamped to the render area
+	int minX, maxX, minY, maxY;
+	// size class of the whole triangle, kept when the bounding box is clipped to a tile
+	TriangleSize size;
+};
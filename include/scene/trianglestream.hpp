@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include "math/vector3.hpp"
+#include "math/matrix4.hpp"
+
+// alignment in bytes of the stream arrays, a cache line and the widest SIMD register
+#define STREAM_ALIGNMENT 64
+// number of floats the arrays are padded to, loops may run up to the padded size without a scalar tail
+#define STREAM_PADDING (STREAM_ALIGNMENT / sizeof(float))
+
+/**
+ * @brief standard allocator returning STREAM_ALIGNMENT aligned memory
+ * 
+ */
+template <typename T>
+struct AlignedAllocator {
+	using value_type = T;
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U> &) {}
+
+	T *allocate(std::size_t count) {
+		return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(STREAM_ALIGNMENT)));
+	}
+
+	void deallocate(T *pointer, std::size_t) {
+		::operator delete(pointer, std::align_val_t(STREAM_ALIGNMENT));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U> &) const {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U> &) const {
+		return false;
+	}
+};
+
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+
+/**
+ * @brief triangle positions stored as a structure of arrays
+ * 
+ * each coordinate of each corner has its own aligned array, so the loops over
+ * the triangles of a frame read consecutive floats and compile to packed SIMD
+ * instructions, the arrays are padded with finite values to a multiple of
+ * STREAM_PADDING triangles
+ */
+class TriangleStream {
+	public:
+		TriangleStream();
+
+		unsigned size() const;
+		unsigned paddedSize() const;
+		void clear();
+		void swap(TriangleStream &other);
+		void push(const Vector3f &v1, const Vector3f &v2, const Vector3f &v3);
+		void push(const TriangleStream &other, unsigned index);
+		void append(const TriangleStream &other);
+		void append(const TriangleStream &other, const uint32_t *indices, unsigned count);
+		void transform(const Matrix4 &matrix, unsigned first);
+
+		inline Vector3f vertex(unsigned index, unsigned corner) const;
+		inline void getTriangle(unsigned index, Vector3f *vertices) const;
+
+		// coordinates of the first, second and third corner of each triangle
+		AlignedFloats x[3], y[3], z[3];
+
+	private:
+		unsigned count;
+};
+
+/**
+ * @brief read a corner of a triangle
+ * 
+ * @param index the triangle index
+ * @param corner the corner, 0 to 2
+ * @return Vector3f the corner position
+ */
+inline Vector3f TriangleStream::vertex(unsigned index, unsigned corner) const {
+	return Vector3f(this->x[corner][index], this->y[corner][index], this->z[corner][index]);
+}
+
+/**
+ * @brief read the three corners of a triangle
+ * 
+ * @param index the triangle index
+ * @param vertices filled with the 3 corner positions
+ */
+inline void TriangleStream::getTriangle(unsigned index, Vector3f *vertices) const {
+	for (unsigned corner = 0; corner < 3; corner++) {
+		vertices[corner] = this->vertex(index, corner);
+	}
+}
@@ -1,9 +1,9 @@
 #pragma once
 
 #define CAMERA_DISTANCE 500.0
-#include <SFML/Graphics/Color.hpp>
-#include <SFML/System/Vector2.hpp>
+#include "math/color.hpp"
 #include <vector>
+#include <memory>
 #include <stdexcept>
 #include <iostream>
 #include "math/vector3.hpp"
@@ -13,13 +13,15 @@
 class Cube : public Shape  {
 	public:
 		Cube(Vector3f size = Vector3f(10, 10, 10));
-		void setFaceColor(const unsigned face, const sf::Color color);
-		void setFacesColors(const sf::Color colors[6]);
+		void setFaceColor(const unsigned face, const Color color);
+		void setFacesColors(const Color colors[6]);
+		void setTexture(std::shared_ptr<const Texture> texture);
 	
-		sf::Color color;
+		Color color;
 	
 	private:
 		void shape_update() override;
 		void shape_init() override;
+		void transformVertices(Vector3f *positions) const;
 		
 };
\ No newline at end of file
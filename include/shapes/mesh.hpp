@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "math/vector2.hpp"
+#include "math/vector3.hpp"
+#include "math/color.hpp"
+#include "shapes/triangle.hpp"
+#include "scene/texture.hpp"
+#include "scene/bvh.hpp"
+
+/**
+ * @brief triangles sharing their vertices: an array of unique vertices and 3 vertex indices per triangle
+ * 
+ * a vertex used by several triangles is stored once, so it can be transformed
+ * and lit once per frame then read by index by each of its triangles
+ */
+struct Mesh {
+	// attributes of each unique vertex, a zero normal is unknown
+	std::vector<Vector3f> positions, normals;
+	std::vector<Vector2f> uvs;
+	// vertex indices of each triangle, in the order of the Triangle vertices
+	std::vector<uint32_t> indices;
+	// (v2 - v1) x (v3 - v1) of each triangle, not normalized, empty until computed
+	std::vector<Vector3f> faceNormals;
+	// color of each triangle
+	std::vector<Color> colors;
+	// texture of each triangle, nullptr for a colored one, empty if the mesh is not textured
+	std::vector<std::shared_ptr<const Texture>> textures;
+	// hierarchy over the triangles in the space of the positions, empty if the shape does not build one
+	Bvh bvh;
+	// largest distance of the triangles to the full detail surface, in the space of the positions, 0 for a full detail mesh
+	float error = 0;
+
+	unsigned triangleCount() const;
+	Triangle getTriangle(unsigned index) const;
+	void computeFaceNormals();
+	void clear();
+};
@@ -1,15 +1,28 @@
 #pragma once
 
-#include <SFML/Graphics/Color.hpp>
+#include "math/color.hpp"
 #include <string>
 #include <cstring>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <tuple>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include <numeric>
 
 #include "shapes/shape.hpp"
 #include "shapes/triangle.hpp"
+#include "shapes/simplifier.hpp"
+
+// each level of detail keeps this ratio of the triangles of the previous one
+#define LOD_REDUCTION 0.5f
+// no level is built below this number of triangles
+#define LOD_MIN_TRIANGLES 32
+// most simplified levels built for a file
+#define LOD_MAX_LEVELS 8
 
 class ObjLoader : public Shape{
 	public:
@@ -17,6 +30,12 @@ class ObjLoader : public Shape{
 		ObjLoader(const ObjLoader& other);
 
 		void loadObjFile(const std::string &filename);
+
+		std::vector<Triangle> getTriangles() override;
+		std::vector<Color> getColors() override;
+		std::vector<std::shared_ptr<const Texture>> getTextures() override;
+		const Mesh *getMesh() override;
+		const Mesh *getLevel(unsigned level) override;
 		
 		bool isLoaded() const;
 		std::string getFileName() const;
@@ -30,13 +49,26 @@ class ObjLoader : public Shape{
 		void shape_update() override;
 
 		bool objLoaded;
-		std::vector<Triangle> objTriangles;
-		std::vector<sf::Color> objColors;
+		// the loaded mesh scaled and rotated, and its positions and normals as they are in the file
+		Mesh mesh;
+		std::vector<Vector3f> objPositions, objNormals;
+		// simplified meshes from the finest to the coarsest, transformed with the mesh
+		std::vector<Mesh> levels;
+		// mesh vertex of each vertex of the levels, and error of the levels in the units of the file
+		std::vector<std::vector<uint32_t>> levelVertices;
+		std::vector<float> levelErrors;
 		std::string fileName;
 		std::ifstream file;
 		std::vector<Vector3f> verticles, normals;
-		std::map<std::string, sf::Color> materialColors;
-		sf::Color currentColor;
+		std::vector<Vector2f> texCoords;
+		// mesh vertex of each position, texture coordinates and normal indices triplet of the file
+		std::map<std::tuple<int, int, int>, uint32_t> meshVertices;
+		// position index of each mesh vertex, to share normals between faces
+		std::vector<unsigned> objIndices;
+		std::map<std::string, Color> materialColors;
+		std::map<std::string, std::shared_ptr<const Texture>> materialTextures;
+		Color currentColor;
+		std::shared_ptr<const Texture> currentTexture;
 		std::vector<std::string> split(const std::string &s, char delim);
 		bool initFileStream();
 		bool parseVertex(std::string &lineType);
@@ -44,4 +76,8 @@ class ObjLoader : public Shape{
 		bool parseMTL(std::string &lineType);
 		bool loadMTL(std::ifstream &file);
 		bool setMTL(std::string &lineType);
+		bool loadTexture(const std::string &materialName, const std::string &textureFile);
+		void smoothNormals();
+		void buildLevels();
+		void transformMesh();
 };
\ No newline at end of file
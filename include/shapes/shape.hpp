@@ -1,10 +1,27 @@
 #pragma once
 
-#include <SFML/Graphics/Color.hpp>
+#include "math/color.hpp"
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
 #include "math/vector3.hpp"
 #include "math/matrix4.hpp"
 #include "shapes/triangle.hpp"
+#include "shapes/mesh.hpp"
+#include "scene/texture.hpp"
+
+/**
+ * @brief bounding volumes of a shape in its own space, once scaled and rotated
+ * 
+ */
+struct ShapeBounds {
+	// axis aligned bounding box
+	Vector3f min, max;
+	// sphere centered on the box, a negative radius means the shape has no known vertex
+	Vector3f center;
+	float radius = -1;
+};
 
 class Shape {
 	public:
@@ -19,10 +36,23 @@ class Shape {
 			this->update();
 			return this->triangles;
 		};
-		virtual std::vector<sf::Color> getColors() {
+		virtual std::vector<Color> getColors() {
 			this->update();
 			return this->colors;
 		};
+		// texture of each triangle, nullptr for a colored one, empty if the shape is not textured
+		virtual std::vector<std::shared_ptr<const Texture>> getTextures() {
+			this->update();
+			return this->textures;
+		};
+		// indexed version of the triangles, nullptr if the shape only has a triangle list
+		virtual const Mesh *getMesh() {
+			return nullptr;
+		};
+		// simplified version of the mesh, level 0 is the mesh itself, nullptr past the coarsest level
+		virtual const Mesh *getLevel(unsigned level) {
+			return level == 0 ? this->getMesh() : nullptr;
+		};
 
 		void setSize(Vector3f size);
 		void setSize(float x, float y, float z);
@@ -35,13 +65,21 @@ class Shape {
 		void rotate(Vector3f rotation);
 		void rotate(float x, float y, float z);
 
+		const ShapeBounds &getBounds();
+		unsigned getRevision();
+
 	protected:
 		Vector3f size, rotation;
 		Matrix4 rotationMatrix;
 		bool updateNeeded; //avoid unnecessary updates
+		// incremented each time the triangles, colors or textures change
+		unsigned revision;
 		std::vector<Triangle> triangles;
-		std::vector<sf::Color> colors;
+		std::vector<Color> colors;
+		std::vector<std::shared_ptr<const Texture>> textures;
+		ShapeBounds bounds;
 
 		virtual void shape_init() = 0;
 		virtual void shape_update() = 0;
+		void computeBounds();
 };
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "math/vector3.hpp"
+
+/**
+ * @brief topology of a position of a mesh being simplified, which tells the collapses it allows
+ * 
+ */
+enum SimplifierVertex {
+	// inside the surface with a single vertex, moved onto any neighbor
+	SIMPLIFIER_MANIFOLD,
+	// on an open border, only moved along the border so the outline is kept
+	SIMPLIFIER_BORDER,
+	// between 2 sides with different vertices or triangle groups, only moved along the seam so it does not crack
+	SIMPLIFIER_SEAM,
+	// corners of borders or seams and non manifold positions, never moved
+	SIMPLIFIER_LOCKED
+};
+
+/**
+ * @brief reduce the triangles of an indexed mesh by quadric error edge collapses
+ * 
+ * the vertices are welded by position and each collapse moves a position onto one
+ * of its neighbors, the one nearest to the planes of the triangles merged into both
+ * of them so far, each vertex of the moved position takes the vertex of the kept
+ * position on the same side of the seams, and the triangles sharing their edge are
+ * removed, the kept positions never move so each simplified mesh reuses a subset
+ * of the original vertices
+ * 
+ * the edges between triangles of different groups, such as materials, are seams
+ * too, so the outline of each group is kept, collapses flipping a triangle or
+ * pinching the surface are skipped
+ * 
+ * simplify() can be called with decreasing triangle counts to build a chain of levels of detail
+ */
+class MeshSimplifier {
+	public:
+		MeshSimplifier(const std::vector<Vector3f> &positions, const std::vector<uint32_t> &indices, const std::vector<uint32_t> &groups = {});
+
+		float simplify(unsigned triangles);
+		unsigned getTriangleCount() const;
+		float getError() const;
+		void getTriangles(std::vector<uint32_t> &indices, std::vector<uint32_t> &sources) const;
+
+	private:
+		// plane equations summed as a symmetric 4x4 matrix, weighted by the area of their triangles
+		struct Quadric {
+			double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+			double area = 0;
+
+			void addPlane(const Vector3f &normal, const Vector3f &point, double area);
+			void add(const Quadric &other);
+			double distance(const Vector3f &point) const;
+		};
+
+		// a position moved onto a neighbor, ordered by increasing cost in the queue
+		struct Collapse {
+			float cost;
+			uint32_t from, to;
+			unsigned version;
+
+			bool operator<(const Collapse &other) const {
+				return this->cost > other.cost;
+			}
+		};
+
+		uint64_t getWedge(uint32_t triangle, unsigned corner) const;
+		void classifyVertices();
+		void computeQuadrics();
+		float collapseCost(uint32_t from, uint32_t to) const;
+		bool isValid(uint32_t from, uint32_t to);
+		void findCollapse(uint32_t vertex);
+		void collapse(uint32_t from, uint32_t to);
+		void getNeighbors(uint32_t vertex, std::vector<uint32_t> &neighbors) const;
+
+		std::vector<Vector3f> positions;
+		std::vector<uint32_t> indices;
+		// group of each triangle, empty if they are all in the same one
+		std::vector<uint32_t> groups;
+		// first vertex of the position of each vertex, the positions are named by it
+		std::vector<uint32_t> welded;
+		// SimplifierVertex of each position
+		std::vector<char> kinds;
+		// triangles removed by a collapse and positions moved away
+		std::vector<char> removedTriangles, removedVertices;
+		// triangles of each position, the removed ones are skipped when they are read
+		std::vector<std::vector<uint32_t>> vertexTriangles;
+		std::vector<Quadric> quadrics;
+		// incremented each time the best collapse of a position is computed again, older queue entries are ignored
+		std::vector<unsigned> versions;
+		std::priority_queue<Collapse> queue;
+		// scratch lists of the neighbors of the 2 positions of a collapse and of the vertex each moved vertex takes
+		std::vector<uint32_t> neighbors, otherNeighbors;
+		std::vector<std::pair<uint32_t, uint32_t>> vertexMap;
+		unsigned triangleCount;
+		float error;
+};
@@ -2,6 +2,9 @@
 
 #include <stdexcept>
 #include <tuple>
+#include <vector>
+#include <cstddef>
+#include "math/vector2.hpp"
 #include "math/vector3.hpp"
 #include "math/matrix4.hpp"
 
@@ -18,6 +21,7 @@ class Triangle {
 
 		Vector3f getCenter() const;
 		Vector3f getNormal() const;
+		Vector3f getVertexNormal(unsigned index) const;
 
 		std::pair<Vector3f, Vector3f> getLeftRightIntersection(
 			const Vector3f &planeNormal, 
@@ -31,9 +35,14 @@ class Triangle {
 		) const;
 
 		void applyTransform(const Matrix4 &rotation, const Vector3f &translation);
+		static void applyTransform(Triangle *triangles, size_t count, const Matrix4 &rotation, const Vector3f &size);
 
 		Vector3f v1;
 		Vector3f v2;
 		Vector3f v3;
 		Vector3f normal;
+		// per vertex normals used for smooth shading, null if unknown
+		Vector3f vertexNormals[3];
+		// texture coordinates of each vertex, v goes down the image rows
+		Vector2f uvs[3];
 };
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "adapter/sfmlpresenter.hpp"
+
+/**
+ * @brief draw the color buffer of a framebuffer at the top left corner of a target
+ * 
+ * @param framebuffer the rendered image
+ * @param target the window or texture to draw in
+ */
+void SfmlPresenter::draw(const Framebuffer &framebuffer, sf::RenderTarget &target) {
+	unsigned width = framebuffer.getWidth();
+	unsigned height = framebuffer.getHeight();
+	if (width == 0 || height == 0) {
+		return;
+	}
+
+	if (this->texture.getSize() != sf::Vector2u(width, height)) {
+		this->texture.create(width, height);
+		this->sprite.setTexture(this->texture, true);
+	}
+
+	const sf::Uint8 *pixels = framebuffer.getColorBuffer();
+	if (framebuffer.getStride() != width) {
+		// sfml expects tightly packed rows
+		this->packed.resize(width * height * 4);
+		for (unsigned y = 0; y < height; y++) {
+			std::memcpy(&this->packed[y * width * 4], pixels + y * framebuffer.getStride() * 4, width * 4);
+		}
+		pixels = this->packed.data();
+	}
+
+	this->texture.update(pixels);
+	target.draw(this->sprite);
+}
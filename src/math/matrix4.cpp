@@ -75,6 +75,325 @@ void Matrix4::setColumn(unsigned column, Vector3f vector) {
 	this->values[column + 8] = vector.z;
 }
 
+/**
+ * @brief transform a direction, only the linear part of the matrix is applied
+ * 
+ * @param direction the vector to transform, a normal for example
+ * @return Vector3f the transformed vector, without translation nor perspective division
+ */
+Vector3f Matrix4::transformDirection(const Vector3f &direction) const {
+	return Vector3f(
+		this->values[0] * direction.x + this->values[1] * direction.y + this->values[2] * direction.z,
+		this->values[4] * direction.x + this->values[5] * direction.y + this->values[6] * direction.z,
+		this->values[8] * direction.x + this->values[9] * direction.y + this->values[10] * direction.z
+	);
+}
+
+/**
+ * @brief compute the inverse of the matrix with its cofactors
+ * 
+ * the cofactors are built from the determinants of the 2x2 blocks of the two
+ * upper lines and of the two lower lines
+ * 
+ * @param result set to the matrix M^-1 such that M * M^-1 is the identity, left unchanged if M is singular
+ * @return bool false if the matrix is singular
+ */
+bool Matrix4::inverse(Matrix4 &result) const {
+	const Matrix4 &m = *this;
+	float s0 = m.at(0, 0) * m.at(1, 1) - m.at(1, 0) * m.at(0, 1);
+	float s1 = m.at(0, 0) * m.at(1, 2) - m.at(1, 0) * m.at(0, 2);
+	float s2 = m.at(0, 0) * m.at(1, 3) - m.at(1, 0) * m.at(0, 3);
+	float s3 = m.at(0, 1) * m.at(1, 2) - m.at(1, 1) * m.at(0, 2);
+	float s4 = m.at(0, 1) * m.at(1, 3) - m.at(1, 1) * m.at(0, 3);
+	float s5 = m.at(0, 2) * m.at(1, 3) - m.at(1, 2) * m.at(0, 3);
+	float c0 = m.at(2, 0) * m.at(3, 1) - m.at(3, 0) * m.at(2, 1);
+	float c1 = m.at(2, 0) * m.at(3, 2) - m.at(3, 0) * m.at(2, 2);
+	float c2 = m.at(2, 0) * m.at(3, 3) - m.at(3, 0) * m.at(2, 3);
+	float c3 = m.at(2, 1) * m.at(3, 2) - m.at(3, 1) * m.at(2, 2);
+	float c4 = m.at(2, 1) * m.at(3, 3) - m.at(3, 1) * m.at(2, 3);
+	float c5 = m.at(2, 2) * m.at(3, 3) - m.at(3, 2) * m.at(2, 3);
+
+	float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (determinant == 0 || !std::isfinite(determinant)) {
+		return false;
+	}
+	float scale = 1 / determinant;
+
+	float values[4][4] = {
+		{
+			(m.at(1, 1) * c5 - m.at(1, 2) * c4 + m.at(1, 3) * c3) * scale,
+			(-m.at(0, 1) * c5 + m.at(0, 2) * c4 - m.at(0, 3) * c3) * scale,
+			(m.at(3, 1) * s5 - m.at(3, 2) * s4 + m.at(3, 3) * s3) * scale,
+			(-m.at(2, 1) * s5 + m.at(2, 2) * s4 - m.at(2, 3) * s3) * scale
+		}, {
+			(-m.at(1, 0) * c5 + m.at(1, 2) * c2 - m.at(1, 3) * c1) * scale,
+			(m.at(0, 0) * c5 - m.at(0, 2) * c2 + m.at(0, 3) * c1) * scale,
+			(-m.at(3, 0) * s5 + m.at(3, 2) * s2 - m.at(3, 3) * s1) * scale,
+			(m.at(2, 0) * s5 - m.at(2, 2) * s2 + m.at(2, 3) * s1) * scale
+		}, {
+			(m.at(1, 0) * c4 - m.at(1, 1) * c2 + m.at(1, 3) * c0) * scale,
+			(-m.at(0, 0) * c4 + m.at(0, 1) * c2 - m.at(0, 3) * c0) * scale,
+			(m.at(3, 0) * s4 - m.at(3, 1) * s2 + m.at(3, 3) * s0) * scale,
+			(-m.at(2, 0) * s4 + m.at(2, 1) * s2 - m.at(2, 3) * s0) * scale
+		}, {
+			(-m.at(1, 0) * c3 + m.at(1, 1) * c1 - m.at(1, 2) * c0) * scale,
+			(m.at(0, 0) * c3 - m.at(0, 1) * c1 + m.at(0, 2) * c0) * scale,
+			(-m.at(3, 0) * s3 + m.at(3, 1) * s1 - m.at(3, 2) * s0) * scale,
+			(m.at(2, 0) * s3 - m.at(2, 1) * s1 + m.at(2, 2) * s0) * scale
+		}
+	};
+	result = Matrix4(values);
+	return true;
+}
+
+/**
+ * @brief compute the inverse of the matrix
+ * 
+ * @return Matrix4 the matrix M^-1 such that M * M^-1 is the identity
+ * @throws std::runtime_error if the matrix is singular
+ */
+Matrix4 Matrix4::inverse() const {
+	Matrix4 result;
+	if (!this->inverse(result)) {
+		throw std::runtime_error("Matrix4::inverse: singular matrix");
+	}
+	return result;
+}
+
+namespace {
+
+#if defined(__SSE2__)
+/**
+ * @brief load 4 consecutive vectors and transpose them to one register per coordinate
+ * 
+ * @param input 12 floats: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+ * @param x the 4 x coordinates
+ * @param y the 4 y coordinates
+ * @param z the 4 z coordinates
+ */
+inline void loadVectors(const float *input, __m128 &x, __m128 &y, __m128 &z) {
+	__m128 a = _mm_loadu_ps(input);
+	__m128 b = _mm_loadu_ps(input + 4);
+	__m128 c = _mm_loadu_ps(input + 8);
+	x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+	y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/**
+ * @brief transpose 4 vectors back to consecutive x, y, z floats and store them
+ * 
+ * @see loadVectors
+ */
+inline void storeVectors(float *output, __m128 x, __m128 y, __m128 z) {
+	__m128 low = _mm_unpacklo_ps(x, y); // x0 y0 x1 y1
+	__m128 high = _mm_unpackhi_ps(x, y); // x2 y2 x3 y3
+	__m128 a = _mm_shuffle_ps(low, _mm_shuffle_ps(z, low, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+	__m128 b = _mm_shuffle_ps(_mm_shuffle_ps(low, z, _MM_SHUFFLE(1, 1, 3, 3)), high, _MM_SHUFFLE(1, 0, 2, 0));
+	__m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, high, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(high, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	_mm_storeu_ps(output, a);
+	_mm_storeu_ps(output + 4, b);
+	_mm_storeu_ps(output + 8, c);
+}
+#endif
+
+/**
+ * @brief transform one vector stored as x, y, z floats
+ * 
+ * @tparam translate add the last column of the matrix, false for directions
+ * @tparam divide divide by the w coordinate when it is not zero, false for affine matrices
+ * @param m the 16 matrix values, line by line
+ * @param input the vector to transform
+ * @param output the transformed vector, may be the input
+ */
+template <bool translate, bool divide>
+inline void transformVector(const float *m, const float *input, float *output) {
+	float x = input[0], y = input[1], z = input[2];
+	float result[3];
+	for (int i = 0; i < 3; i++) {
+		result[i] = m[i * 4] * x + m[i * 4 + 1] * y + m[i * 4 + 2] * z;
+		if (translate) {
+			result[i] += m[i * 4 + 3];
+		}
+	}
+	if (divide) {
+		float w = m[12] * x + m[13] * y + m[14] * z + m[15];
+		if (w != 0) {
+			for (int i = 0; i < 3; i++) {
+				result[i] /= w;
+			}
+		}
+	}
+	for (int i = 0; i < 3; i++) {
+		output[i] = result[i];
+	}
+}
+
+/**
+ * @brief transform consecutive vectors stored as x, y, z floats, MATRIX4_SIMD_WIDTH at once
+ * 
+ * each group of vectors is transposed to one register per coordinate so every
+ * lane computes the same products as transformVector() and gives the same result
+ * 
+ * @see transformVector
+ * @param count the number of vectors, the last ones that do not fill a register are transformed one by one
+ */
+template <bool translate, bool divide>
+void transformVectors(const float *m, const float *input, float *output, size_t count) {
+	size_t i = 0;
+#if defined(__AVX2__)
+	__m256 rows[4][4];
+	for (int line = 0; line < 4; line++) {
+		for (int column = 0; column < 4; column++) {
+			rows[line][column] = _mm256_set1_ps(m[line * 4 + column]);
+		}
+	}
+	for (; i + 8 <= count; i += 8) {
+		__m128 x0, y0, z0, x1, y1, z1;
+		loadVectors(input + i * 3, x0, y0, z0);
+		loadVectors(input + i * 3 + 12, x1, y1, z1);
+		__m256 x = _mm256_set_m128(x1, x0);
+		__m256 y = _mm256_set_m128(y1, y0);
+		__m256 z = _mm256_set_m128(z1, z0);
+
+		__m256 result[3];
+		for (int line = 0; line < 3; line++) {
+			result[line] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rows[line][0], x), _mm256_mul_ps(rows[line][1], y)), _mm256_mul_ps(rows[line][2], z));
+			if (translate) {
+				result[line] = _mm256_add_ps(result[line], rows[line][3]);
+			}
+		}
+		if (divide) {
+			__m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rows[3][0], x), _mm256_mul_ps(rows[3][1], y)), _mm256_mul_ps(rows[3][2], z)), rows[3][3]);
+			// lanes with a zero w are divided by 1
+			w = _mm256_blendv_ps(_mm256_set1_ps(1.0f), w, _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+			for (int line = 0; line < 3; line++) {
+				result[line] = _mm256_div_ps(result[line], w);
+			}
+		}
+
+		storeVectors(output + i * 3, _mm256_castps256_ps128(result[0]), _mm256_castps256_ps128(result[1]), _mm256_castps256_ps128(result[2]));
+		storeVectors(output + i * 3 + 12, _mm256_extractf128_ps(result[0], 1), _mm256_extractf128_ps(result[1], 1), _mm256_extractf128_ps(result[2], 1));
+	}
+#elif defined(__SSE2__)
+	__m128 rows[4][4];
+	for (int line = 0; line < 4; line++) {
+		for (int column = 0; column < 4; column++) {
+			rows[line][column] = _mm_set1_ps(m[line * 4 + column]);
+		}
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 x, y, z;
+		loadVectors(input + i * 3, x, y, z);
+
+		__m128 result[3];
+		for (int line = 0; line < 3; line++) {
+			result[line] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[line][0], x), _mm_mul_ps(rows[line][1], y)), _mm_mul_ps(rows[line][2], z));
+			if (translate) {
+				result[line] = _mm_add_ps(result[line], rows[line][3]);
+			}
+		}
+		if (divide) {
+			__m128 w = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[3][0], x), _mm_mul_ps(rows[3][1], y)), _mm_mul_ps(rows[3][2], z)), rows[3][3]);
+			// lanes with a zero w are divided by 1
+			__m128 nonZero = _mm_cmpneq_ps(w, _mm_setzero_ps());
+			w = _mm_or_ps(_mm_and_ps(nonZero, w), _mm_andnot_ps(nonZero, _mm_set1_ps(1.0f)));
+			for (int line = 0; line < 3; line++) {
+				result[line] = _mm_div_ps(result[line], w);
+			}
+		}
+
+		storeVectors(output + i * 3, result[0], result[1], result[2]);
+	}
+#endif
+	for (; i < count; i++) {
+		transformVector<translate, divide>(m, input + i * 3, output + i * 3);
+	}
+}
+
+}
+
+/**
+ * @brief transform a span of points, the batched version of the matrix vector product
+ * 
+ * @param points the points to transform
+ * @param results the transformed points, may be the points
+ * @param count the number of points
+ * @param affine skip the perspective division, the last line of the matrix must then be 0 0 0 1
+ */
+void Matrix4::transformPoints(const Vector3f *points, Vector3f *results, size_t count, bool affine) const {
+	static_assert(sizeof(Vector3f) == 3 * sizeof(float), "vectors must be packed floats");
+	const float *input = reinterpret_cast<const float *>(points);
+	float *output = reinterpret_cast<float *>(results);
+	if (affine) {
+		transformVectors<true, false>(this->values, input, output, count);
+	} else {
+		transformVectors<true, true>(this->values, input, output, count);
+	}
+}
+
+/**
+ * @brief transform a span of directions, the batched version of transformDirection()
+ * 
+ * @param directions the vectors to transform, normals for example
+ * @param results the transformed vectors, may be the directions
+ * @param count the number of vectors
+ */
+void Matrix4::transformDirections(const Vector3f *directions, Vector3f *results, size_t count) const {
+	transformVectors<false, false>(this->values, reinterpret_cast<const float *>(directions), reinterpret_cast<float *>(results), count);
+}
+
+/**
+ * @brief transform in place points stored as one array per coordinate, the matrix must be affine
+ * 
+ * @param x the x coordinates
+ * @param y the y coordinates
+ * @param z the z coordinates
+ * @param count the number of points
+ */
+void Matrix4::transformPoints(float *x, float *y, float *z, size_t count) const {
+	const float *m = this->values;
+	size_t i = 0;
+#if defined(__AVX2__)
+	__m256 rows[3][4];
+	for (int line = 0; line < 3; line++) {
+		for (int column = 0; column < 4; column++) {
+			rows[line][column] = _mm256_set1_ps(m[line * 4 + column]);
+		}
+	}
+	for (; i + 8 <= count; i += 8) {
+		__m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+		float *outputs[3] = {x + i, y + i, z + i};
+		for (int line = 0; line < 3; line++) {
+			__m256 result = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rows[line][0], vx), _mm256_mul_ps(rows[line][1], vy)), _mm256_mul_ps(rows[line][2], vz));
+			_mm256_storeu_ps(outputs[line], _mm256_add_ps(result, rows[line][3]));
+		}
+	}
+#elif defined(__SSE2__)
+	__m128 rows[3][4];
+	for (int line = 0; line < 3; line++) {
+		for (int column = 0; column < 4; column++) {
+			rows[line][column] = _mm_set1_ps(m[line * 4 + column]);
+		}
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+		float *outputs[3] = {x + i, y + i, z + i};
+		for (int line = 0; line < 3; line++) {
+			__m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rows[line][0], vx), _mm_mul_ps(rows[line][1], vy)), _mm_mul_ps(rows[line][2], vz));
+			_mm_storeu_ps(outputs[line], _mm_add_ps(result, rows[line][3]));
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		float point[3] = {x[i], y[i], z[i]};
+		transformVector<true, false>(m, point, point);
+		x[i] = point[0];
+		y[i] = point[1];
+		z[i] = point[2];
+	}
+}
+
 /**
  * @brief return a projection matrix based on the given parameters
  * 
@@ -252,24 +571,8 @@ Matrix4 operator*(const Matrix4& left, const Matrix4& right) {
 }
 
 Vector3f operator*(const Matrix4& left, const Vector3f& right) {
-	float w = 0;
 	Vector3f result;
-
-	for (int i = 0; i < 3; i++) {
-		for (int j = 0; j < 3; j++) {
-			result(i) += left.at(i, j) * right.at(j);
-		}
-		result(i) += left.at(i, 3);
-	}
-	for (int i = 0; i < 3; i++) {
-		w += left.at(3, i) * right.at(i);
-	}
-	w += left.at(3, 3);
-
-	if (w != 0) {
-		result /= w;
-	}
-
+	transformVector<true, true>(left.values, &right.x, &result.x);
 	return result;
 }
 
@@ -0,0 +1,571 @@
+#include "scene/bvh.hpp"
+
+/**
+ * @brief create an empty box, growing it by a point gives the box of that point
+ * 
+ */
+BoundingBox::BoundingBox() :
+	min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()),
+	max(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max())
+{}
+
+BoundingBox::BoundingBox(const Vector3f &min, const Vector3f &max) :
+	min(min),
+	max(max)
+{}
+
+/**
+ * @brief extend the box so it contains a point
+ * 
+ * @param point the point to include
+ */
+void BoundingBox::grow(const Vector3f &point) {
+	this->min = Vector3f(std::min(this->min.x, point.x), std::min(this->min.y, point.y), std::min(this->min.z, point.z));
+	this->max = Vector3f(std::max(this->max.x, point.x), std::max(this->max.y, point.y), std::max(this->max.z, point.z));
+}
+
+/**
+ * @brief extend the box so it contains another box
+ * 
+ * @param box the box to include, nothing changes if it is empty
+ */
+void BoundingBox::grow(const BoundingBox &box) {
+	this->min = Vector3f(std::min(this->min.x, box.min.x), std::min(this->min.y, box.min.y), std::min(this->min.z, box.min.z));
+	this->max = Vector3f(std::max(this->max.x, box.max.x), std::max(this->max.y, box.max.y), std::max(this->max.z, box.max.z));
+}
+
+/**
+ * @brief check if the box contains no point
+ * 
+ * @return bool true if the box was never grown
+ */
+bool BoundingBox::empty() const {
+	return this->min.x > this->max.x || this->min.y > this->max.y || this->min.z > this->max.z;
+}
+
+/**
+ * @brief half the surface area of the box, the probability for a random ray to hit it is proportional to it
+ * 
+ * @return float the half area, 0 for an empty box
+ */
+float BoundingBox::area() const {
+	if (this->empty()) {
+		return 0;
+	}
+	Vector3f extent = this->max - this->min;
+	return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+/**
+ * @brief get the center of the box
+ * 
+ * @return Vector3f the middle of the minimum and the maximum
+ */
+Vector3f BoundingBox::center() const {
+	return (this->min + this->max) * 0.5f;
+}
+
+namespace {
+
+/**
+ * @brief read a coordinate of a vector
+ * 
+ * @param vector the vector to read
+ * @param axis 0 for x, 1 for y, 2 for z
+ * @return float the coordinate
+ */
+inline float coordinate(const Vector3f &vector, int axis) {
+	return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+}
+
+/**
+ * @brief make a 4 float box empty
+ * 
+ * @param min the 4 minimum coordinates, 16 byte aligned
+ * @param max the 4 maximum coordinates, 16 byte aligned
+ */
+inline void resetBox(float *min, float *max) {
+	for (int i = 0; i < 4; i++) {
+		min[i] = std::numeric_limits<float>::max();
+		max[i] = -std::numeric_limits<float>::max();
+	}
+}
+
+/**
+ * @brief extend a 4 float box so it contains another one
+ * 
+ * @param min the minimum coordinates of the box to extend
+ * @param max the maximum coordinates of the box to extend
+ * @param otherMin the minimum coordinates of the box to include
+ * @param otherMax the maximum coordinates of the box to include
+ */
+inline void growBox(float *min, float *max, const float *otherMin, const float *otherMax) {
+#if defined(__SSE2__)
+	_mm_store_ps(min, _mm_min_ps(_mm_load_ps(min), _mm_load_ps(otherMin)));
+	_mm_store_ps(max, _mm_max_ps(_mm_load_ps(max), _mm_load_ps(otherMax)));
+#else
+	for (int i = 0; i < 4; i++) {
+		min[i] = std::min(min[i], otherMin[i]);
+		max[i] = std::max(max[i], otherMax[i]);
+	}
+#endif
+}
+
+/**
+ * @brief half the surface area of a 4 float box
+ * 
+ * @see BoundingBox::area
+ */
+inline float boxArea(const float *min, const float *max) {
+	float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+	return x < 0 ? 0 : x * y + y * z + z * x;
+}
+
+/**
+ * @brief find the bin of the centroid of a box along each axis
+ * 
+ * @param min the minimum coordinates of the box
+ * @param max the maximum coordinates of the box
+ * @param low the lowest centroid coordinates of the node
+ * @param scale the number of bins per unit along each axis
+ * @param last the index of the last bin
+ * @param bins filled with the bin index along each axis, 0 to last
+ */
+inline void binIndices(const float *min, const float *max, const float *low, const float *scale, float last, int *bins) {
+#if defined(__SSE2__)
+	__m128 centroid = _mm_mul_ps(_mm_add_ps(_mm_load_ps(min), _mm_load_ps(max)), _mm_set1_ps(0.5f));
+	__m128 position = _mm_mul_ps(_mm_sub_ps(centroid, _mm_load_ps(low)), _mm_load_ps(scale));
+	position = _mm_max_ps(_mm_min_ps(position, _mm_set1_ps(last)), _mm_setzero_ps());
+	_mm_storeu_si128((__m128i *)bins, _mm_cvttps_epi32(position));
+#else
+	for (int i = 0; i < 4; i++) {
+		float position = ((min[i] + max[i]) * 0.5f - low[i]) * scale[i];
+		bins[i] = std::max(0.0f, std::min(position, last));
+	}
+#endif
+}
+
+}
+
+Bvh::Bvh() :
+	cost(0),
+	builtCost(0)
+{}
+
+/**
+ * @brief build the tree from scratch over a list of primitives
+ * 
+ * each node is split at the bin boundary of the axis giving the smallest expected
+ * query cost, a node becomes a leaf when no split is cheaper than testing all its
+ * primitives and it has at most BVH_MAX_LEAF_SIZE of them, the storage of the
+ * previous tree is reused
+ * 
+ * @param boxes the bounding box of each primitive, none of them may be empty
+ */
+void Bvh::build(const std::vector<BoundingBox> &boxes) {
+	this->nodes.clear();
+	this->indices.resize(boxes.size());
+	std::iota(this->indices.begin(), this->indices.end(), 0);
+	if (boxes.empty()) {
+		this->cost = this->builtCost = 0;
+		return;
+	}
+
+	this->references.resize(boxes.size());
+	SplitBox bounds, centroidBounds;
+	resetBox(bounds.min, bounds.max);
+	resetBox(centroidBounds.min, centroidBounds.max);
+	for (unsigned i = 0; i < boxes.size(); i++) {
+		SplitBox &reference = this->references[i];
+		for (int axis = 0; axis < 3; axis++) {
+			reference.min[axis] = coordinate(boxes[i].min, axis);
+			reference.max[axis] = coordinate(boxes[i].max, axis);
+		}
+		reference.min[3] = reference.max[3] = 0;
+		growBox(bounds.min, bounds.max, reference.min, reference.max);
+		alignas(16) float centroid[4];
+		for (int axis = 0; axis < 4; axis++) {
+			centroid[axis] = (reference.min[axis] + reference.max[axis]) * 0.5f;
+		}
+		growBox(centroidBounds.min, centroidBounds.max, centroid, centroid);
+	}
+
+	// the root is alone in the first pair so the children pairs start at even indices
+	this->nodes.reserve(boxes.size() * 2);
+	this->nodes.resize(2);
+	BvhNode &root = this->nodes[0];
+	this->setBounds(root, BoundingBox(Vector3f(bounds.min[0], bounds.min[1], bounds.min[2]), Vector3f(bounds.max[0], bounds.max[1], bounds.max[2])));
+	root.first = 0;
+	root.count = boxes.size();
+	this->nodes[1] = root;
+	this->nodes[1].count = 0;
+
+	struct Pending {
+		unsigned node, depth;
+		SplitBox centroidBounds;
+	};
+	std::vector<Pending> pending = {{0, 0, centroidBounds}};
+	while (!pending.empty()) {
+		Pending current = pending.back();
+		pending.pop_back();
+		SplitBox childCentroids[2];
+		if (this->split(current.node, current.depth, current.centroidBounds, childCentroids)) {
+			unsigned left = this->nodes[current.node].first;
+			pending.push_back({left + 1, current.depth + 1, childCentroids[1]});
+			pending.push_back({left, current.depth + 1, childCentroids[0]});
+		}
+	}
+
+	this->computeCost();
+	this->builtCost = this->cost;
+}
+
+/**
+ * @brief build the tree over the triangles of an indexed mesh
+ * 
+ * @param positions the vertex positions
+ * @param indices 3 vertex indices per triangle
+ * @param triangles the number of triangles
+ */
+void Bvh::build(const Vector3f *positions, const uint32_t *indices, unsigned triangles) {
+	this->computeTriangleBoxes(positions, indices, triangles);
+	this->build(this->primitiveBoxes);
+}
+
+/**
+ * @brief split a leaf in two with the binned surface area heuristic
+ * 
+ * the centroids of the primitives are sorted into bins along the 3 axes in a
+ * single pass, BVH_BINS of them or one per primitive for the small leaves, a
+ * sweep from both ends gives the cost of each bin boundary, the primitives of
+ * the leaf are then partitioned in place so each child reads its boxes in order
+ * 
+ * @param node the index of the leaf
+ * @param depth the depth of the leaf, the root is at 0
+ * @param centroidBounds the box of the centroids of the leaf primitives
+ * @param childCentroids filled with the boxes of the centroids of the left and right children
+ * @return bool true if the leaf got two children
+ */
+bool Bvh::split(unsigned node, unsigned depth, const SplitBox &centroidBounds, SplitBox *childCentroids) {
+	uint32_t first = this->nodes[node].first;
+	uint32_t count = this->nodes[node].count;
+	if (count <= 1 || depth >= BVH_MAX_DEPTH) {
+		return false;
+	}
+	SplitBox *references = &this->references[first];
+	uint32_t *indices = &this->indices[first];
+
+	unsigned binCount = std::min<unsigned>(count, BVH_BINS);
+	alignas(16) float low[4], scale[4];
+	for (int axis = 0; axis < 4; axis++) {
+		low[axis] = centroidBounds.min[axis];
+		float extent = centroidBounds.max[axis] - low[axis];
+		// a flat axis puts everything in its first bin
+		scale[axis] = axis < 3 && extent > 0 ? binCount / extent : 0;
+	}
+
+	SplitBox bins[3][BVH_BINS];
+	unsigned binCounts[3][BVH_BINS] = {};
+	for (int axis = 0; axis < 3; axis++) {
+		for (unsigned bin = 0; bin < binCount; bin++) {
+			resetBox(bins[axis][bin].min, bins[axis][bin].max);
+		}
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		const SplitBox &reference = references[i];
+		alignas(16) int binIndex[4];
+		binIndices(reference.min, reference.max, low, scale, binCount - 1, binIndex);
+		for (int axis = 0; axis < 3; axis++) {
+			SplitBox &bin = bins[axis][binIndex[axis]];
+			growBox(bin.min, bin.max, reference.min, reference.max);
+			binCounts[axis][binIndex[axis]]++;
+		}
+	}
+
+	float bestCost = std::numeric_limits<float>::max();
+	int bestAxis = -1;
+	unsigned bestSplit = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		if (scale[axis] == 0) {
+			continue;
+		}
+
+		// cost of the primitives on the left of each boundary, then of the right ones while sweeping back
+		float leftCosts[BVH_BINS];
+		SplitBox side;
+		resetBox(side.min, side.max);
+		unsigned sideCount = 0;
+		for (unsigned bin = 0; bin < binCount - 1; bin++) {
+			growBox(side.min, side.max, bins[axis][bin].min, bins[axis][bin].max);
+			sideCount += binCounts[axis][bin];
+			leftCosts[bin] = boxArea(side.min, side.max) * sideCount;
+		}
+		resetBox(side.min, side.max);
+		sideCount = 0;
+		for (unsigned bin = binCount - 1; bin > 0; bin--) {
+			growBox(side.min, side.max, bins[axis][bin].min, bins[axis][bin].max);
+			sideCount += binCounts[axis][bin];
+			float cost = leftCosts[bin - 1] + boxArea(side.min, side.max) * sideCount;
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = bin;
+			}
+		}
+	}
+	if (bestAxis < 0) {
+		// all the centroids are at the same place
+		return false;
+	}
+
+	float area = this->getBounds(this->nodes[node]).area();
+	float leafCost = count;
+	float splitCost = BVH_TRAVERSAL_COST + (area > 0 ? bestCost / area : count);
+	if (splitCost >= leafCost && count <= BVH_MAX_LEAF_SIZE) {
+		return false;
+	}
+
+	// the left primitives are moved to the front and the right ones to the back
+	for (int child = 0; child < 2; child++) {
+		resetBox(childCentroids[child].min, childCentroids[child].max);
+	}
+	uint32_t leftCount = 0, rightStart = count;
+	while (leftCount < rightStart) {
+		const SplitBox &reference = references[leftCount];
+		alignas(16) int binIndex[4];
+		binIndices(reference.min, reference.max, low, scale, binCount - 1, binIndex);
+		alignas(16) float centroid[4];
+		for (int axis = 0; axis < 4; axis++) {
+			centroid[axis] = (reference.min[axis] + reference.max[axis]) * 0.5f;
+		}
+		if ((unsigned)binIndex[bestAxis] < bestSplit) {
+			growBox(childCentroids[0].min, childCentroids[0].max, centroid, centroid);
+			leftCount++;
+		} else {
+			growBox(childCentroids[1].min, childCentroids[1].max, centroid, centroid);
+			rightStart--;
+			std::swap(references[leftCount], references[rightStart]);
+			std::swap(indices[leftCount], indices[rightStart]);
+		}
+	}
+	if (leftCount == 0 || leftCount == count) {
+		return false;
+	}
+
+	SplitBox childBounds[2];
+	for (int child = 0; child < 2; child++) {
+		resetBox(childBounds[child].min, childBounds[child].max);
+	}
+	for (unsigned bin = 0; bin < binCount; bin++) {
+		SplitBox &bounds = childBounds[bin < bestSplit ? 0 : 1];
+		growBox(bounds.min, bounds.max, bins[bestAxis][bin].min, bins[bestAxis][bin].max);
+	}
+	unsigned left = this->nodes.size();
+	this->nodes.resize(left + 2);
+	for (int child = 0; child < 2; child++) {
+		BvhNode &childNode = this->nodes[left + child];
+		const SplitBox &bounds = childBounds[child];
+		this->setBounds(childNode, BoundingBox(Vector3f(bounds.min[0], bounds.min[1], bounds.min[2]), Vector3f(bounds.max[0], bounds.max[1], bounds.max[2])));
+		childNode.first = child == 0 ? first : first + leftCount;
+		childNode.count = child == 0 ? leftCount : count - leftCount;
+	}
+
+	this->nodes[node].first = left;
+	this->nodes[node].count = 0;
+	return true;
+}
+
+/**
+ * @brief recompute the bounds of every node after the primitives moved, the tree is not restructured
+ * 
+ * children are always stored after their parent, so a single backward pass
+ * over the nodes updates the leaves before the nodes above them
+ * 
+ * @param boxes the new bounding box of each primitive, as many as the tree was built with
+ */
+void Bvh::refit(const std::vector<BoundingBox> &boxes) {
+	if (boxes.size() != this->indices.size()) {
+		throw std::runtime_error("Bvh::refit: the number of primitives changed");
+	}
+	for (unsigned i = this->nodes.size(); i-- > 0;) {
+		if (i == 1) {
+			// padding after the root
+			continue;
+		}
+		BvhNode &node = this->nodes[i];
+		BoundingBox bounds;
+		if (node.isLeaf()) {
+			for (uint32_t j = node.first; j < node.first + node.count; j++) {
+				bounds.grow(boxes[this->indices[j]]);
+			}
+		} else {
+			bounds = this->getBounds(this->nodes[node.first]);
+			bounds.grow(this->getBounds(this->nodes[node.first + 1]));
+		}
+		this->setBounds(node, bounds);
+	}
+	this->computeCost();
+}
+
+/**
+ * @brief refit the tree over the moved triangles of an indexed mesh
+ * 
+ * @see Bvh::build
+ */
+void Bvh::refit(const Vector3f *positions, const uint32_t *indices, unsigned triangles) {
+	this->computeTriangleBoxes(positions, indices, triangles);
+	this->refit(this->primitiveBoxes);
+}
+
+/**
+ * @brief follow moving primitives: refit the tree, or rebuild it when refitting is not possible or not good enough
+ * 
+ * the tree is rebuilt when the number of primitives changed or when its expected
+ * query cost grew above BVH_REFIT_LIMIT times its cost once built
+ * 
+ * @param boxes the bounding box of each primitive
+ */
+void Bvh::update(const std::vector<BoundingBox> &boxes) {
+	if (boxes.size() != this->indices.size() || this->nodes.empty()) {
+		this->build(boxes);
+		return;
+	}
+	this->refit(boxes);
+	if (this->cost > this->builtCost * BVH_REFIT_LIMIT) {
+		this->build(boxes);
+	}
+}
+
+/**
+ * @brief follow the moving triangles of an indexed mesh
+ * 
+ * @see Bvh::build
+ */
+void Bvh::update(const Vector3f *positions, const uint32_t *indices, unsigned triangles) {
+	this->computeTriangleBoxes(positions, indices, triangles);
+	this->update(this->primitiveBoxes);
+}
+
+/**
+ * @brief remove all the nodes
+ * 
+ */
+void Bvh::clear() {
+	this->nodes.clear();
+	this->indices.clear();
+	this->cost = this->builtCost = 0;
+}
+
+/**
+ * @brief check if the tree has no node
+ * 
+ * @return bool true if it was never built or built without primitive
+ */
+bool Bvh::empty() const {
+	return this->nodes.empty();
+}
+
+/**
+ * @brief get the number of primitives the tree was built with
+ * 
+ * @return unsigned the number of primitive indices
+ */
+unsigned Bvh::getPrimitiveCount() const {
+	return this->indices.size();
+}
+
+/**
+ * @brief get the box of all the primitives
+ * 
+ * @return BoundingBox the bounds of the root, empty if the tree is
+ */
+BoundingBox Bvh::getBounds() const {
+	return this->nodes.empty() ? BoundingBox() : this->getBounds(this->nodes[0]);
+}
+
+/**
+ * @brief expected number of node visits and primitive tests of a query, from the surface area heuristic
+ * 
+ * @return float the cost relative to testing one primitive
+ */
+float Bvh::getCost() const {
+	return this->cost;
+}
+
+/**
+ * @brief get the flattened nodes, the root is the first one and the second one is unused
+ * 
+ * @return const std::vector<BvhNode, AlignedAllocator<BvhNode>>& the nodes
+ */
+const std::vector<BvhNode, AlignedAllocator<BvhNode>> &Bvh::getNodes() const {
+	return this->nodes;
+}
+
+/**
+ * @brief get the primitive indices the leaves point into
+ * 
+ * @return const std::vector<uint32_t>& the primitives, grouped by leaf
+ */
+const std::vector<uint32_t> &Bvh::getIndices() const {
+	return this->indices;
+}
+
+/**
+ * @brief compute the bounding box of each triangle of an indexed mesh
+ * 
+ * @see Bvh::build
+ */
+void Bvh::computeTriangleBoxes(const Vector3f *positions, const uint32_t *indices, unsigned triangles) {
+	this->primitiveBoxes.resize(triangles);
+	for (unsigned i = 0; i < triangles; i++) {
+		BoundingBox &box = this->primitiveBoxes[i];
+		box = BoundingBox(positions[indices[i * 3]], positions[indices[i * 3]]);
+		box.grow(positions[indices[i * 3 + 1]]);
+		box.grow(positions[indices[i * 3 + 2]]);
+	}
+}
+
+/**
+ * @brief store a box in a node
+ * 
+ * @param node the node to update
+ * @param box its new bounds
+ */
+void Bvh::setBounds(BvhNode &node, const BoundingBox &box) const {
+	node.min[0] = box.min.x;
+	node.min[1] = box.min.y;
+	node.min[2] = box.min.z;
+	node.max[0] = box.max.x;
+	node.max[1] = box.max.y;
+	node.max[2] = box.max.z;
+}
+
+/**
+ * @brief read the box of a node
+ * 
+ * @param node the node to read
+ * @return BoundingBox its bounds
+ */
+BoundingBox Bvh::getBounds(const BvhNode &node) const {
+	return BoundingBox(Vector3f(node.min[0], node.min[1], node.min[2]), Vector3f(node.max[0], node.max[1], node.max[2]));
+}
+
+/**
+ * @brief compute the expected cost of a query, the sum over the nodes of the probability to reach them times their cost
+ * 
+ */
+void Bvh::computeCost() {
+	this->cost = 0;
+	float rootArea = this->getBounds().area();
+	if (!(rootArea > 0)) {
+		return;
+	}
+	for (unsigned i = 0; i < this->nodes.size(); i++) {
+		if (i == 1) {
+			continue;
+		}
+		const BvhNode &node = this->nodes[i];
+		float probability = this->getBounds(node).area() / rootArea;
+		this->cost += probability * (node.isLeaf() ? node.count : BVH_TRAVERSAL_COST);
+	}
+}
@@ -0,0 +1,397 @@
+#include "scene/framebuffer.hpp"
+
+/**
+ * @brief create a framebuffer, cleared to transparent black and infinite depth
+ * 
+ * @param width number of visible pixels of each row
+ * @param height number of rows
+ * @param stride distance between two rows in pixels, 0 to use the width
+ */
+Framebuffer::Framebuffer(unsigned width, unsigned height, unsigned stride) {
+	this->resize(width, height, stride);
+}
+
+/**
+ * @brief change the framebuffer size, the content is cleared
+ * 
+ * @param width number of visible pixels of each row
+ * @param height number of rows
+ * @param stride distance between two rows in pixels, 0 to use the width
+ */
+void Framebuffer::resize(unsigned width, unsigned height, unsigned stride) {
+	if (stride == 0) {
+		stride = width;
+	}
+	if (stride < width) {
+		throw std::runtime_error("Framebuffer::resize: stride is smaller than width");
+	}
+	this->width = width;
+	this->height = height;
+	this->stride = stride;
+	this->colorBuffer.assign((size_t)stride * height * 4, 0);
+	this->depthBuffer.assign((size_t)stride * height, 0);
+	if (!this->idBuffer.empty()) {
+		this->idBuffer.assign((size_t)stride * height, NO_TRIANGLE);
+	}
+
+	this->tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	this->tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	this->tiles.assign(this->tilesX * this->tilesY, TILE_CLEARED);
+	this->pending = false;
+	this->clearColor = 0;
+	this->clearDepth = 0;
+}
+
+/**
+ * @brief clear both buffers in O(tiles), the pixels are written when the tiles are resolved
+ * 
+ * @param color the color of every pixel
+ * @param depth the 1/z value of every pixel, 0 is infinitely far
+ */
+void Framebuffer::clear(const Color &color, float depth) {
+	uint8_t bytes[4] = {color.r, color.g, color.b, color.a};
+	uint32_t packed;
+	std::memcpy(&packed, bytes, sizeof(packed));
+
+	// tiles holding other clear values must be filled again too
+	bool sameValues = packed == this->clearColor && depth == this->clearDepth;
+	this->clearColor = packed;
+	this->clearDepth = depth;
+	for (TileState &tile : this->tiles) {
+		if (tile == TILE_DRAWN || !sameValues) {
+			tile = TILE_PENDING;
+			this->pending = true;
+		}
+	}
+}
+
+/**
+ * @brief clear every pixel of both buffers immediately
+ * 
+ * @param color the color of every pixel
+ * @param depth the 1/z value of every pixel, 0 is infinitely far
+ */
+void Framebuffer::fill(const Color &color, float depth) {
+	this->clear(color, depth);
+	uint32_t *pixels = reinterpret_cast<uint32_t *>(this->colorBuffer.data());
+	std::fill(pixels, pixels + this->depthBuffer.size(), this->clearColor);
+	std::fill(this->depthBuffer.begin(), this->depthBuffer.end(), depth);
+	std::fill(this->idBuffer.begin(), this->idBuffer.end(), NO_TRIANGLE);
+	std::fill(this->tiles.begin(), this->tiles.end(), TILE_CLEARED);
+	this->pending = false;
+}
+
+/**
+ * @brief copy the color and depth buffers of another framebuffer of the same size
+ * 
+ * the clears pending in the other framebuffer stay pending in this one,
+ * the id buffer is left as it is
+ * 
+ * @param other the framebuffer to copy
+ */
+void Framebuffer::copy(const Framebuffer &other) {
+	if (other.width != this->width || other.height != this->height || other.stride != this->stride) {
+		throw std::runtime_error("Framebuffer::copy: the framebuffers have different sizes");
+	}
+	std::copy(other.colorBuffer.begin(), other.colorBuffer.end(), this->colorBuffer.begin());
+	std::copy(other.depthBuffer.begin(), other.depthBuffer.end(), this->depthBuffer.begin());
+	std::copy(other.tiles.begin(), other.tiles.end(), this->tiles.begin());
+	this->pending = other.pending;
+	this->clearColor = other.clearColor;
+	this->clearDepth = other.clearDepth;
+}
+
+/**
+ * @brief write the clear values in the pixels of a tile
+ * 
+ * @param tileX the tile column
+ * @param tileY the tile row
+ */
+void Framebuffer::fillTile(unsigned tileX, unsigned tileY) {
+	unsigned minX = tileX * TILE_SIZE;
+	unsigned minY = tileY * TILE_SIZE;
+	unsigned maxX = std::min(minX + TILE_SIZE, this->width);
+	unsigned maxY = std::min(minY + TILE_SIZE, this->height);
+	uint32_t *pixels = reinterpret_cast<uint32_t *>(this->colorBuffer.data());
+	for (unsigned y = minY; y < maxY; y++) {
+		size_t row = (size_t)y * this->stride;
+		std::fill(pixels + row + minX, pixels + row + maxX, this->clearColor);
+		std::fill(&this->depthBuffer[row + minX], &this->depthBuffer[row + maxX], this->clearDepth);
+	}
+	this->clearTileIds(tileX, tileY);
+}
+
+/**
+ * @brief write NO_TRIANGLE in the id buffer pixels of a tile, if there is an id buffer
+ * 
+ * @param tileX the tile column
+ * @param tileY the tile row
+ */
+void Framebuffer::clearTileIds(unsigned tileX, unsigned tileY) {
+	if (this->idBuffer.empty()) {
+		return;
+	}
+	unsigned minX = tileX * TILE_SIZE;
+	unsigned minY = tileY * TILE_SIZE;
+	unsigned maxX = std::min(minX + TILE_SIZE, this->width);
+	unsigned maxY = std::min(minY + TILE_SIZE, this->height);
+	for (unsigned y = minY; y < maxY; y++) {
+		size_t row = (size_t)y * this->stride;
+		std::fill(&this->idBuffer[row + minX], &this->idBuffer[row + maxX], NO_TRIANGLE);
+	}
+}
+
+/**
+ * @brief make a tile ready to be drawn in, filling it if a clear is pending
+ * 
+ * different tiles can be resolved in parallel
+ * 
+ * @param tileX the tile column
+ * @param tileY the tile row
+ */
+void Framebuffer::resolveTile(unsigned tileX, unsigned tileY) {
+	TileState &tile = this->tiles[tileY * this->tilesX + tileX];
+	if (tile == TILE_PENDING) {
+		this->fillTile(tileX, tileY);
+	}
+	tile = TILE_DRAWN;
+}
+
+/**
+ * @brief fill every tile with a pending clear so the whole buffers can be read
+ * 
+ */
+void Framebuffer::resolve() {
+	if (!this->pending) {
+		return;
+	}
+	for (unsigned tileY = 0; tileY < this->tilesY; tileY++) {
+		for (unsigned tileX = 0; tileX < this->tilesX; tileX++) {
+			TileState &tile = this->tiles[tileY * this->tilesX + tileX];
+			if (tile == TILE_PENDING) {
+				this->fillTile(tileX, tileY);
+				tile = TILE_CLEARED;
+			}
+		}
+	}
+	this->pending = false;
+}
+
+/**
+ * @brief get the number of visible pixels of each row
+ * 
+ * @return unsigned the width in pixels
+ */
+unsigned Framebuffer::getWidth() const {
+	return this->width;
+}
+
+/**
+ * @brief get the number of rows
+ * 
+ * @return unsigned the height in pixels
+ */
+unsigned Framebuffer::getHeight() const {
+	return this->height;
+}
+
+/**
+ * @brief get the distance between two rows of the buffers
+ * 
+ * @return unsigned the stride in pixels
+ */
+unsigned Framebuffer::getStride() const {
+	return this->stride;
+}
+
+/**
+ * @brief get the number of tile columns
+ * 
+ * @return unsigned the number of TILE_SIZE wide columns covering the width
+ */
+unsigned Framebuffer::getTilesX() const {
+	return this->tilesX;
+}
+
+/**
+ * @brief get the number of tile rows
+ * 
+ * @return unsigned the number of TILE_SIZE high rows covering the height
+ */
+unsigned Framebuffer::getTilesY() const {
+	return this->tilesY;
+}
+
+/**
+ * @brief get the color buffer, 4 bytes per pixel in RGBA order
+ * 
+ * @return uint8_t* the first byte of the first row
+ */
+uint8_t *Framebuffer::getColorBuffer() {
+	return this->colorBuffer.data();
+}
+
+/**
+ * @see Framebuffer::getColorBuffer()
+ */
+const uint8_t *Framebuffer::getColorBuffer() const {
+	return this->colorBuffer.data();
+}
+
+/**
+ * @brief get the depth buffer, one 1/z float per pixel
+ * 
+ * @return float* the first value of the first row
+ */
+float *Framebuffer::getDepthBuffer() {
+	return this->depthBuffer.data();
+}
+
+/**
+ * @see Framebuffer::getDepthBuffer()
+ */
+const float *Framebuffer::getDepthBuffer() const {
+	return this->depthBuffer.data();
+}
+
+/**
+ * @brief allocate or free the id buffer, a new id buffer holds NO_TRIANGLE everywhere
+ * 
+ * @param enabled true to keep an id buffer
+ */
+void Framebuffer::setIdBuffer(bool enabled) {
+	if (!enabled) {
+		this->idBuffer = std::vector<uint32_t>();
+	} else if (this->idBuffer.empty()) {
+		this->idBuffer.assign((size_t)this->stride * this->height, NO_TRIANGLE);
+	}
+}
+
+/**
+ * @brief check if the framebuffer has an id buffer
+ * 
+ * @return bool true if the id buffer is allocated
+ */
+bool Framebuffer::hasIdBuffer() const {
+	return !this->idBuffer.empty();
+}
+
+/**
+ * @brief get the id buffer, one 32 bit triangle id per pixel
+ * 
+ * @return uint32_t* the first id of the first row, nullptr if there is no id buffer
+ */
+uint32_t *Framebuffer::getIdBuffer() {
+	return this->idBuffer.empty() ? nullptr : this->idBuffer.data();
+}
+
+/**
+ * @see Framebuffer::getIdBuffer()
+ */
+const uint32_t *Framebuffer::getIdBuffer() const {
+	return this->idBuffer.empty() ? nullptr : this->idBuffer.data();
+}
+
+/**
+ * @brief read the color of a pixel
+ * 
+ * @param x the pixel column
+ * @param y the pixel row
+ * @return Color the pixel color
+ */
+Color Framebuffer::getPixel(unsigned x, unsigned y) const {
+	const uint8_t *pixel = &this->colorBuffer[((size_t)y * this->stride + x) * 4];
+	return Color(pixel[0], pixel[1], pixel[2], pixel[3]);
+}
+
+/**
+ * @brief write the color of a pixel, the depth is left unchanged
+ * 
+ * the tile of the pixel is resolved first
+ * 
+ * @param x the pixel column
+ * @param y the pixel row
+ * @param color the pixel color
+ */
+void Framebuffer::setPixel(unsigned x, unsigned y, const Color &color) {
+	this->resolveTile(x / TILE_SIZE, y / TILE_SIZE);
+	uint8_t *pixel = &this->colorBuffer[((size_t)y * this->stride + x) * 4];
+	pixel[0] = color.r;
+	pixel[1] = color.g;
+	pixel[2] = color.b;
+	pixel[3] = color.a;
+}
+
+/**
+ * @brief read the depth of a pixel
+ * 
+ * @param x the pixel column
+ * @param y the pixel row
+ * @return float the 1/z value of the pixel, 0 if nothing was drawn
+ */
+float Framebuffer::getDepth(unsigned x, unsigned y) const {
+	return this->depthBuffer[(size_t)y * this->stride + x];
+}
+
+/**
+ * @brief read the triangle id of a pixel
+ * 
+ * @param x the pixel column
+ * @param y the pixel row
+ * @return uint32_t the id, NO_TRIANGLE if no triangle covers the pixel or if there is no id buffer
+ */
+uint32_t Framebuffer::getId(unsigned x, unsigned y) const {
+	if (this->idBuffer.empty()) {
+		return NO_TRIANGLE;
+	}
+	return this->idBuffer[(size_t)y * this->stride + x];
+}
+
+/**
+ * @brief draw a one pixel wide line over the color buffer, without depth test
+ * 
+ * the segment is clipped to the framebuffer first so lines going far off screen stay cheap
+ * 
+ * @param from first end of the line in pixels
+ * @param to second end of the line in pixels
+ * @param color the line color
+ */
+void Framebuffer::drawLine(Vector2f from, Vector2f to, const Color &color) {
+	// Liang-Barsky clipping against [0, width] x [0, height]
+	float t0 = 0, t1 = 1;
+	float dx = to.x - from.x, dy = to.y - from.y;
+	float p[4] = {-dx, dx, -dy, dy};
+	float q[4] = {from.x, this->width - from.x, from.y, this->height - from.y};
+	for (int i = 0; i < 4; i++) {
+		if (p[i] == 0) {
+			if (q[i] < 0) {
+				return;
+			}
+			continue;
+		}
+		float t = q[i] / p[i];
+		if (p[i] < 0) {
+			t0 = std::max(t0, t);
+		} else {
+			t1 = std::min(t1, t);
+		}
+	}
+	if (!(t0 <= t1)) {
+		return;
+	}
+	to = from + Vector2f(dx, dy) * t1;
+	from = from + Vector2f(dx, dy) * t0;
+
+	dx = to.x - from.x;
+	dy = to.y - from.y;
+	int steps = std::ceil(std::max(std::abs(dx), std::abs(dy)));
+	float stepX = steps > 0 ? dx / steps : 0;
+	float stepY = steps > 0 ? dy / steps : 0;
+	for (int i = 0; i <= steps; i++) {
+		int x = std::floor(from.x + stepX * i);
+		int y = std::floor(from.y + stepY * i);
+		if (x >= 0 && y >= 0 && x < (int)this->width && y < (int)this->height) {
+			this->setPixel(x, y, color);
+		}
+	}
+}
@@ -0,0 +1,857 @@
+#include "scene/rasterizer.hpp"
+
+namespace {
+
+/**
+ * @brief shading of the flat kernels, every pixel gets the triangle color
+ * 
+ */
+struct FlatShader {
+	FlatShader(const Color &color) : packed(Rasterizer::packColor(color)) {}
+	FlatShader(uint32_t packed) : packed(packed) {}
+
+	void row(int) {}
+
+	uint32_t shade(float, float) const {
+		return this->packed;
+	}
+
+#if defined(__AVX2__)
+	__m256i shade(__m256, __m256, int) const {
+		return _mm256_set1_epi32(this->packed);
+	}
+#elif defined(__SSE2__)
+	__m128i shade(__m128, __m128, int) const {
+		return _mm_set1_epi32(this->packed);
+	}
+#endif
+
+	uint32_t packed;
+};
+
+/**
+ * @brief shading of the smooth kernels, the varyings are the red, green and blue channels
+ * 
+ * each varying/z plane is evaluated once per row then once per pixel like the depth,
+ * and divided by the interpolated 1/z to be perspective correct
+ */
+struct SmoothShader {
+	SmoothShader(const TriangleSetup &setup) : setup(setup) {
+#if defined(__AVX2__)
+		for (int i = 0; i < 3; i++) {
+			this->a[i] = _mm256_set1_ps(setup.varyingA[i]);
+		}
+#elif defined(__SSE2__)
+		for (int i = 0; i < 3; i++) {
+			this->a[i] = _mm_set1_ps(setup.varyingA[i]);
+		}
+#endif
+	}
+
+	void row(int y) {
+		for (int i = 0; i < 3; i++) {
+			this->rowValue[i] = this->setup.varyingB[i] * y + this->setup.varyingC[i];
+#if defined(__AVX2__)
+			this->c[i] = _mm256_set1_ps(this->rowValue[i]);
+#elif defined(__SSE2__)
+			this->c[i] = _mm_set1_ps(this->rowValue[i]);
+#endif
+		}
+	}
+
+	uint32_t shade(float x, float z) const {
+		float w = 1.0f / z;
+		uint32_t packed = 0xff000000;
+		for (int i = 0; i < 3; i++) {
+			float value = (this->setup.varyingA[i] * x + this->rowValue[i]) * w;
+			value = std::min(255.0f, std::max(0.0f, value));
+			packed |= (uint32_t)std::lrint(value) << (8 * i);
+		}
+		return packed;
+	}
+
+#if defined(__AVX2__)
+	__m256i shade(__m256 x, __m256 z, int) const {
+		__m256 w = _mm256_div_ps(_mm256_set1_ps(1.0f), z);
+		__m256i packed = _mm256_set1_epi32(0xff000000);
+		for (int i = 0; i < 3; i++) {
+			__m256 value = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(this->a[i], x), this->c[i]), w);
+			value = _mm256_min_ps(_mm256_set1_ps(255.0f), _mm256_max_ps(_mm256_setzero_ps(), value));
+			packed = _mm256_or_si256(packed, _mm256_slli_epi32(_mm256_cvtps_epi32(value), 8 * i));
+		}
+		return packed;
+	}
+
+	__m256 a[3], c[3];
+#elif defined(__SSE2__)
+	__m128i shade(__m128 x, __m128 z, int) const {
+		__m128 w = _mm_div_ps(_mm_set1_ps(1.0f), z);
+		__m128i packed = _mm_set1_epi32(0xff000000);
+		for (int i = 0; i < 3; i++) {
+			__m128 value = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(this->a[i], x), this->c[i]), w);
+			value = _mm_min_ps(_mm_set1_ps(255.0f), _mm_max_ps(_mm_setzero_ps(), value));
+			packed = _mm_or_si128(packed, _mm_slli_epi32(_mm_cvtps_epi32(value), 8 * i));
+		}
+		return packed;
+	}
+
+	__m128 a[3], c[3];
+#endif
+
+	const TriangleSetup &setup;
+	float rowValue[3];
+};
+
+/**
+ * @brief shading of the textured kernels, the varyings are the texture coordinates and the light intensity
+ * 
+ * the mip level is chosen once per 2x2 pixel quad, from the derivatives of the texture
+ * coordinates at the quad center computed exactly from the varying/z and 1/z planes,
+ * so the four pixels of a quad read the same level whichever kernel draws them
+ * 
+ * the simd versions compute the coordinates of all lanes at once then sample the
+ * visible lanes one by one
+ */
+struct TexturedShader {
+	TexturedShader(const TriangleSetup &setup) :
+		setup(setup),
+		texture(*setup.texture),
+		width(setup.texture->getWidth()),
+		height(setup.texture->getHeight())
+	{
+#if defined(__AVX2__)
+		for (int i = 0; i < 3; i++) {
+			this->a[i] = _mm256_set1_ps(setup.varyingA[i]);
+		}
+#elif defined(__SSE2__)
+		for (int i = 0; i < 3; i++) {
+			this->a[i] = _mm_set1_ps(setup.varyingA[i]);
+		}
+#endif
+	}
+
+	void row(int y) {
+		float quadY = (y & ~1) + 0.5f;
+		this->quadRowZ = this->setup.depthB * quadY + this->setup.depthC;
+		for (int i = 0; i < 3; i++) {
+			this->rowValue[i] = this->setup.varyingB[i] * y + this->setup.varyingC[i];
+			this->quadRow[i] = this->setup.varyingB[i] * quadY + this->setup.varyingC[i];
+#if defined(__AVX2__)
+			this->c[i] = _mm256_set1_ps(this->rowValue[i]);
+#elif defined(__SSE2__)
+			this->c[i] = _mm_set1_ps(this->rowValue[i]);
+#endif
+		}
+	}
+
+	/**
+	 * @brief squared footprint in texels of the pixels of a quad
+	 * 
+	 * @param x the column of a pixel of the quad
+	 * @return float the biggest squared length of the x and y derivatives of the texture coordinates
+	 */
+	float footprint(int x) const {
+		float quadX = (x & ~1) + 0.5f;
+		float w = 1.0f / (this->setup.depthA * quadX + this->quadRowZ);
+		float u = (this->setup.varyingA[0] * quadX + this->quadRow[0]) * w;
+		float v = (this->setup.varyingA[1] * quadX + this->quadRow[1]) * w;
+		// derivative of (u/z) / (1/z) is (d(u/z) - u * d(1/z)) * z
+		float dudx = (this->setup.varyingA[0] - u * this->setup.depthA) * w * this->width;
+		float dvdx = (this->setup.varyingA[1] - v * this->setup.depthA) * w * this->height;
+		float dudy = (this->setup.varyingB[0] - u * this->setup.depthB) * w * this->width;
+		float dvdy = (this->setup.varyingB[1] - v * this->setup.depthB) * w * this->height;
+		return std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+	}
+
+	/**
+	 * @brief sample the texture at the level of the footprint and scale the texel by the light intensity
+	 * 
+	 */
+	uint32_t texel(float u, float v, float intensity, float footprint) const {
+		uint32_t texel = this->texture.sample(u, v, this->texture.selectLevel(footprint));
+		uint32_t scale = std::lrint(std::min(1.0f, std::max(0.0f, intensity)) * 256);
+		uint32_t rb = (((texel & 0xff00ff) * scale) >> 8) & 0xff00ff;
+		uint32_t g = (((texel >> 8) & 0xff) * scale) & 0xff00;
+		return rb | g | 0xff000000;
+	}
+
+	uint32_t shade(float x, float z) const {
+		float w = 1.0f / z;
+		float u = (this->setup.varyingA[0] * x + this->rowValue[0]) * w;
+		float v = (this->setup.varyingA[1] * x + this->rowValue[1]) * w;
+		float intensity = (this->setup.varyingA[2] * x + this->rowValue[2]) * w;
+		return this->texel(u, v, intensity, this->footprint(x));
+	}
+
+#if defined(__AVX2__)
+	__m256i shade(__m256 x, __m256 z, int visible) const {
+		__m256 w = _mm256_div_ps(_mm256_set1_ps(1.0f), z);
+		alignas(32) float values[3][8];
+		for (int i = 0; i < 3; i++) {
+			_mm256_store_ps(values[i], _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(this->a[i], x), this->c[i]), w));
+		}
+		alignas(32) int columns[8];
+		_mm256_store_si256((__m256i *)columns, _mm256_cvttps_epi32(x));
+
+		alignas(32) uint32_t texels[8] = {};
+		for (int lane = 0; lane < 8; lane++) {
+			if (visible & (1 << lane)) {
+				texels[lane] = this->texel(values[0][lane], values[1][lane], values[2][lane], this->footprint(columns[lane]));
+			}
+		}
+		return _mm256_load_si256((const __m256i *)texels);
+	}
+
+	__m256 a[3], c[3];
+#elif defined(__SSE2__)
+	__m128i shade(__m128 x, __m128 z, int visible) const {
+		__m128 w = _mm_div_ps(_mm_set1_ps(1.0f), z);
+		alignas(16) float values[3][4];
+		for (int i = 0; i < 3; i++) {
+			_mm_store_ps(values[i], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(this->a[i], x), this->c[i]), w));
+		}
+		alignas(16) int columns[4];
+		_mm_store_si128((__m128i *)columns, _mm_cvttps_epi32(x));
+
+		alignas(16) uint32_t texels[4] = {};
+		for (int lane = 0; lane < 4; lane++) {
+			if (visible & (1 << lane)) {
+				texels[lane] = this->texel(values[0][lane], values[1][lane], values[2][lane], this->footprint(columns[lane]));
+			}
+		}
+		return _mm_load_si128((const __m128i *)texels);
+	}
+
+	__m128 a[3], c[3];
+#endif
+
+	const TriangleSetup &setup;
+	const Texture &texture;
+	float width, height;
+	float rowValue[3], quadRow[3], quadRowZ;
+};
+
+}
+
+/**
+ * @brief pack a color in the RGBA byte order of the pixel buffer
+ * 
+ * @param color the color to pack
+ * @return uint32_t the color as stored in memory
+ */
+uint32_t Rasterizer::packColor(const Color &color) {
+	uint8_t bytes[4] = {color.r, color.g, color.b, 255};
+	uint32_t packed;
+	std::memcpy(&packed, bytes, 4);
+	return packed;
+}
+
+/**
+ * @brief return the name of the instruction set used by drawSIMD
+ * 
+ * @return const char* AVX2, SSE2 or scalar
+ */
+const char *Rasterizer::simdName() {
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(__SSE2__)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+/**
+ * @brief reference rasterization with one color, one pixel at a time
+ * 
+ * @param setup the triangle to draw, its bounding box must be inside the buffers
+ * @param color the triangle color
+ * @param pixels RGBA color buffer
+ * @param zBuffer depth buffer
+ * @param stride distance between two rows of the buffers in pixels
+ * @return unsigned the number of pixels written
+ */
+unsigned Rasterizer::drawScalar(const TriangleSetup &setup, const Color &color, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	FlatShader shader(color);
+	return Rasterizer::rasterizeScalar(setup, shader, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief rasterize with one color using the widest available instruction set
+ * 
+ * @see Rasterizer::drawScalar
+ */
+unsigned Rasterizer::drawSIMD(const TriangleSetup &setup, const Color &color, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	FlatShader shader(color);
+	return Rasterizer::rasterizeSIMD(setup, shader, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief reference rasterization of the interpolated varyings, one pixel at a time
+ * 
+ * @param setup the triangle to draw, its varyings must be set
+ * @see Rasterizer::drawScalar
+ */
+unsigned Rasterizer::drawSmoothScalar(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	SmoothShader shader(setup);
+	return Rasterizer::rasterizeScalar(setup, shader, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief rasterize the interpolated varyings using the widest available instruction set
+ * 
+ * @see Rasterizer::drawSmoothScalar
+ */
+unsigned Rasterizer::drawSmoothSIMD(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	SmoothShader shader(setup);
+	return Rasterizer::rasterizeSIMD(setup, shader, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief reference rasterization of a textured triangle, one pixel at a time
+ * 
+ * @param setup the triangle to draw, its varyings and its texture must be set
+ * @see Rasterizer::drawScalar
+ */
+unsigned Rasterizer::drawTexturedScalar(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	TexturedShader shader(setup);
+	return Rasterizer::rasterizeScalar(setup, shader, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief rasterize a textured triangle using the widest available instruction set
+ * 
+ * @see Rasterizer::drawTexturedScalar
+ */
+unsigned Rasterizer::drawTexturedSIMD(const TriangleSetup &setup, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	TexturedShader shader(setup);
+	return Rasterizer::rasterizeSIMD(setup, shader, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief reference rasterization of a triangle id into an id buffer, one pixel at a time
+ * 
+ * @param setup the triangle to draw, its bounding box must be inside the buffers
+ * @param id the value written in the covered pixels
+ * @param ids id buffer
+ * @param zBuffer depth buffer
+ * @param stride distance between two rows of the buffers in pixels
+ * @return unsigned the number of pixels written
+ */
+unsigned Rasterizer::drawIdScalar(const TriangleSetup &setup, uint32_t id, uint32_t *ids, float *zBuffer, unsigned stride) {
+	FlatShader shader(id);
+	return Rasterizer::rasterizeScalar(setup, shader, reinterpret_cast<uint8_t *>(ids), zBuffer, stride);
+}
+
+/**
+ * @brief rasterize a triangle id using the widest available instruction set
+ * 
+ * @see Rasterizer::drawIdScalar
+ */
+unsigned Rasterizer::drawIdSIMD(const TriangleSetup &setup, uint32_t id, uint32_t *ids, float *zBuffer, unsigned stride) {
+	FlatShader shader(id);
+	return Rasterizer::rasterizeSIMD(setup, shader, reinterpret_cast<uint8_t *>(ids), zBuffer, stride);
+}
+
+/**
+ * @brief rasterize a triangle and count the depth tests and the writes of each pixel
+ * 
+ * @param setup the set up triangle, its bounding box must be inside the buffers
+ * @param color the triangle color, for a flat triangle
+ * @param pixels RGBA color buffer
+ * @param zBuffer depth buffer holding 1/z
+ * @param tests incremented for each covered pixel, when it is depth tested
+ * @param writes incremented for each pixel that passes the depth test
+ * @param stride distance between two rows of the buffers in pixels
+ * @return unsigned the number of pixels written
+ */
+unsigned Rasterizer::drawCounted(const TriangleSetup &setup, const Color &color, uint8_t *pixels, float *zBuffer, uint32_t *tests, uint32_t *writes, unsigned stride) {
+	if (setup.texture) {
+		TexturedShader shader(setup);
+		return Rasterizer::rasterizeCounted(setup, shader, pixels, zBuffer, tests, writes, stride);
+	}
+	if (setup.smooth) {
+		SmoothShader shader(setup);
+		return Rasterizer::rasterizeCounted(setup, shader, pixels, zBuffer, tests, writes, stride);
+	}
+	FlatShader shader(color);
+	return Rasterizer::rasterizeCounted(setup, shader, pixels, zBuffer, tests, writes, stride);
+}
+
+/**
+ * @brief rasterize a triangle id and count the depth tests of each pixel,
+ * the writes are counted when the pixels are shaded
+ * 
+ * @see Rasterizer::drawCounted
+ */
+unsigned Rasterizer::drawIdCounted(const TriangleSetup &setup, uint32_t id, uint32_t *ids, float *zBuffer, uint32_t *tests, unsigned stride) {
+	FlatShader shader(id);
+	return Rasterizer::rasterizeCounted(setup, shader, reinterpret_cast<uint8_t *>(ids), zBuffer, tests, nullptr, stride);
+}
+
+/**
+ * @brief shade a run of pixels of a row already depth tested, without coverage nor depth test
+ * 
+ * the shader used is the one the draw functions would use for the triangle
+ * 
+ * @param setup the triangle visible in the pixels
+ * @param color the triangle color, for a flat triangle
+ * @param y the row
+ * @param minX the first pixel of the run
+ * @param maxX the last pixel of the run
+ * @param zBuffer depth buffer holding the 1/z of the triangle in the pixels
+ * @param pixels RGBA color buffer
+ * @param stride distance between two rows of the buffers in pixels
+ */
+void Rasterizer::shadeSpan(const TriangleSetup &setup, const Color &color, int y, int minX, int maxX, const float *zBuffer, uint8_t *pixels, unsigned stride) {
+	if (setup.texture) {
+		TexturedShader shader(setup);
+		Rasterizer::shadeRow(shader, y, minX, maxX, zBuffer, pixels, stride);
+	} else if (setup.smooth) {
+		SmoothShader shader(setup);
+		Rasterizer::shadeRow(shader, y, minX, maxX, zBuffer, pixels, stride);
+	} else {
+		FlatShader shader(color);
+		Rasterizer::shadeRow(shader, y, minX, maxX, zBuffer, pixels, stride);
+	}
+}
+
+/**
+ * @brief shade a run of pixels of a row, there is no edge or depth test so whole
+ * vectors of pixels are shaded when SIMD is available
+ * 
+ * @see Rasterizer::shadeSpan
+ */
+template <typename Shader>
+void Rasterizer::shadeRow(Shader &shader, int y, int minX, int maxX, const float *zBuffer, uint8_t *pixels, unsigned stride) {
+	shader.row(y);
+	unsigned int index = y * stride + minX;
+	int x = minX;
+#if defined(__AVX2__)
+	const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+	for (; x + 7 <= maxX; x += 8, index += 8) {
+		__m256 columns = _mm256_add_ps(_mm256_set1_ps(x), lanes);
+		__m256i colors = shader.shade(columns, _mm256_loadu_ps(zBuffer + index), 0xff);
+		_mm256_storeu_si256((__m256i *)(pixels + index * 4), colors);
+	}
+#elif defined(__SSE2__)
+	const __m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+	for (; x + 3 <= maxX; x += 4, index += 4) {
+		__m128 columns = _mm_add_ps(_mm_set1_ps(x), lanes);
+		__m128i colors = shader.shade(columns, _mm_loadu_ps(zBuffer + index), 0xf);
+		_mm_storeu_si128((__m128i *)(pixels + index * 4), colors);
+	}
+#endif
+	for (; x <= maxX; x++, index++) {
+		uint32_t color = shader.shade(x, zBuffer[index]);
+		std::memcpy(pixels + index * 4, &color, 4);
+	}
+}
+
+/**
+ * @brief walk the pixels of the bounding box one at a time and shade the visible ones
+ * 
+ * @param shader gives the color of a pixel from its x coordinate and its 1/z
+ * @see Rasterizer::drawScalar
+ */
+template <typename Shader>
+unsigned Rasterizer::rasterizeScalar(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	unsigned written = 0;
+	int64_t row[3];
+	for (int i = 0; i < 3; i++) {
+		row[i] = setup.edgeA[i] * setup.minX + setup.edgeB[i] * setup.minY + setup.edgeC[i];
+	}
+
+	for (int y = setup.minY; y <= setup.maxY; y++) {
+		int minX = setup.minX, maxX = setup.maxX;
+		Rasterizer::rowSpan(setup, y, minX, maxX);
+
+		// step the edges from the start of the row along x
+		int64_t w1 = row[0] + setup.edgeA[0] * (minX - setup.minX);
+		int64_t w2 = row[1] + setup.edgeA[1] * (minX - setup.minX);
+		int64_t w3 = row[2] + setup.edgeA[2] * (minX - setup.minX);
+		float rowZ = setup.depthB * y + setup.depthC;
+		shader.row(y);
+
+		unsigned int index = y * stride + minX;
+		for (int x = minX; x <= maxX; x++, index++) {
+			// depth is evaluated like the simd lanes, a multiply then an add, so both kernels give the same result
+			float z = setup.depthA * x + rowZ;
+			if ((w1 | w2 | w3) >= 0 && z > zBuffer[index]) {
+				zBuffer[index] = z;
+				uint32_t color = shader.shade(x, z);
+				std::memcpy(pixels + index * 4, &color, 4);
+				written++;
+			}
+			w1 += setup.edgeA[0];
+			w2 += setup.edgeA[1];
+			w3 += setup.edgeA[2];
+		}
+
+		for (int i = 0; i < 3; i++) {
+			row[i] += setup.edgeB[i];
+		}
+	}
+	return written;
+}
+
+/**
+ * @brief the scalar kernel with per pixel counters
+ * 
+ * @param writes may be null when the writes are counted elsewhere
+ * @see Rasterizer::rasterizeScalar
+ */
+template <typename Shader>
+unsigned Rasterizer::rasterizeCounted(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, uint32_t *tests, uint32_t *writes, unsigned stride) {
+	unsigned written = 0;
+	int64_t row[3];
+	for (int i = 0; i < 3; i++) {
+		row[i] = setup.edgeA[i] * setup.minX + setup.edgeB[i] * setup.minY + setup.edgeC[i];
+	}
+
+	for (int y = setup.minY; y <= setup.maxY; y++) {
+		int64_t w1 = row[0];
+		int64_t w2 = row[1];
+		int64_t w3 = row[2];
+		float rowZ = setup.depthB * y + setup.depthC;
+		shader.row(y);
+
+		unsigned int index = y * stride + setup.minX;
+		for (int x = setup.minX; x <= setup.maxX; x++, index++) {
+			if ((w1 | w2 | w3) >= 0) {
+				tests[index]++;
+				float z = setup.depthA * x + rowZ;
+				if (z > zBuffer[index]) {
+					zBuffer[index] = z;
+					uint32_t color = shader.shade(x, z);
+					std::memcpy(pixels + index * 4, &color, 4);
+					if (writes) {
+						writes[index]++;
+					}
+					written++;
+				}
+			}
+			w1 += setup.edgeA[0];
+			w2 += setup.edgeA[1];
+			w3 += setup.edgeA[2];
+		}
+
+		for (int i = 0; i < 3; i++) {
+			row[i] += setup.edgeB[i];
+		}
+	}
+	return written;
+}
+
+/**
+ * @brief clamp an edge value to 32 bits for the simd kernel
+ * 
+ * the sign of the edge function is kept over a row segment as long as the
+ * x step of the edge times RASTERIZER_SEGMENT is below 2^30 (TriangleSetup::narrowSteps)
+ * 
+ * @param value the edge function at the start of a row segment
+ * @return int32_t the clamped value
+ */
+int32_t Rasterizer::clampEdge(int64_t value) {
+	const int64_t limit = (int64_t)1 << 30;
+	return std::min(limit, std::max(-limit, value));
+}
+
+/**
+ * @brief narrow a row of the bounding box of a large triangle to the pixels between its edges
+ * 
+ * each edge function is affine along the row so the first or the last covered
+ * pixel of each edge is found with an exact integer division, other triangles
+ * keep their bounding box
+ * 
+ * @param setup the triangle
+ * @param y the row
+ * @param minX the first pixel of the row to walk, narrowed
+ * @param maxX the last pixel of the row to walk, narrowed, below minX if the row is empty
+ */
+void Rasterizer::rowSpan(const TriangleSetup &setup, int y, int &minX, int &maxX) {
+	if (setup.size != TRIANGLE_LARGE) {
+		return;
+	}
+	// floor(n / d) for d > 0
+	auto floorDiv = [](int64_t n, int64_t d) {
+		return n >= 0 ? n / d : -((-n + d - 1) / d);
+	};
+	int64_t first = minX, last = maxX;
+	for (int i = 0; i < 3; i++) {
+		int64_t a = setup.edgeA[i];
+		int64_t rest = setup.edgeB[i] * y + setup.edgeC[i];
+		// a * x + rest >= 0
+		if (a > 0) {
+			first = std::max(first, -floorDiv(rest, a));
+		} else if (a < 0) {
+			last = std::min(last, floorDiv(rest, -a));
+		} else if (rest < 0) {
+			last = first - 1;
+		}
+	}
+	if (first > last) {
+		maxX = minX - 1;
+		return;
+	}
+	minX = first;
+	maxX = last;
+}
+
+/**
+ * @brief find the farthest depth (smallest 1/z) of a rectangle of the depth buffer
+ * 
+ * @param zBuffer depth buffer
+ * @param stride distance between two rows of the buffers in pixels
+ * @return float the farthest depth in the inclusive rectangle
+ */
+float Rasterizer::farthestDepthScalar(const float *zBuffer, unsigned stride, int minX, int maxX, int minY, int maxY) {
+	float depth = std::numeric_limits<float>::max();
+	for (int y = minY; y <= maxY; y++) {
+		for (int x = minX; x <= maxX; x++) {
+			depth = std::min(depth, zBuffer[y * stride + x]);
+		}
+	}
+	return depth;
+}
+
+#if defined(__AVX2__)
+
+/**
+ * @brief rasterize 8 pixels at once, the row tail is handled with masked loads and stores
+ * 
+ * @see Rasterizer::rasterizeScalar
+ */
+template <typename Shader>
+unsigned Rasterizer::rasterizeSIMD(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	if (!setup.narrowSteps) {
+		return Rasterizer::rasterizeScalar(setup, shader, pixels, zBuffer, stride);
+	}
+
+	const __m256i minusOne = _mm256_set1_epi32(-1);
+	const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256 az = _mm256_set1_ps(setup.depthA);
+	__m256i laneOffset[3], step[3];
+	for (int i = 0; i < 3; i++) {
+		laneOffset[i] = _mm256_mullo_epi32(_mm256_set1_epi32((int32_t)setup.edgeA[i]), laneIndex);
+		step[i] = _mm256_set1_epi32((int32_t)setup.edgeA[i] * 8);
+	}
+	unsigned written = 0;
+
+	int64_t row[3];
+	for (int i = 0; i < 3; i++) {
+		row[i] = setup.edgeA[i] * setup.minX + setup.edgeB[i] * setup.minY + setup.edgeC[i];
+	}
+
+	for (int y = setup.minY; y <= setup.maxY; y++) {
+		int minX = setup.minX, maxX = setup.maxX;
+		Rasterizer::rowSpan(setup, y, minX, maxX);
+		int64_t segment[3];
+		for (int i = 0; i < 3; i++) {
+			segment[i] = row[i] + setup.edgeA[i] * (minX - setup.minX);
+		}
+		const __m256 cz = _mm256_set1_ps(setup.depthB * y + setup.depthC);
+		shader.row(y);
+
+		for (int start = minX; start <= maxX; start += RASTERIZER_SEGMENT) {
+			const __m256i end = _mm256_set1_epi32(std::min(maxX, start + RASTERIZER_SEGMENT - 1));
+			__m256i w1 = _mm256_add_epi32(_mm256_set1_epi32(clampEdge(segment[0])), laneOffset[0]);
+			__m256i w2 = _mm256_add_epi32(_mm256_set1_epi32(clampEdge(segment[1])), laneOffset[1]);
+			__m256i w3 = _mm256_add_epi32(_mm256_set1_epi32(clampEdge(segment[2])), laneOffset[2]);
+			__m256i xi = _mm256_add_epi32(_mm256_set1_epi32(start), laneIndex);
+			__m256 x = _mm256_add_ps(_mm256_set1_ps(start), lanes);
+
+			unsigned int index = y * stride + start;
+			for (int px = start; px <= start + RASTERIZER_SEGMENT - 1 && px <= maxX; px += 8, index += 8) {
+				__m256i inside = _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(w1, w2), w3), minusOne);
+				__m256i coverage = _mm256_andnot_si256(_mm256_cmpgt_epi32(xi, end), inside);
+
+				if (!_mm256_testz_si256(coverage, coverage)) {
+					__m256 mask = _mm256_castsi256_ps(coverage);
+					__m256 z = _mm256_add_ps(_mm256_mul_ps(az, x), cz);
+					__m256 oldZ = _mm256_maskload_ps(zBuffer + index, coverage);
+					mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, oldZ, _CMP_GT_OQ));
+
+					int visible = _mm256_movemask_ps(mask);
+					if (visible) {
+						__m256i storeMask = _mm256_castps_si256(mask);
+						_mm256_maskstore_ps(zBuffer + index, storeMask, z);
+						_mm256_maskstore_epi32((int *)(pixels + index * 4), storeMask, shader.shade(x, z, visible));
+						written += __builtin_popcount(visible);
+					}
+				}
+
+				w1 = _mm256_add_epi32(w1, step[0]);
+				w2 = _mm256_add_epi32(w2, step[1]);
+				w3 = _mm256_add_epi32(w3, step[2]);
+				xi = _mm256_add_epi32(xi, _mm256_set1_epi32(8));
+				x = _mm256_add_ps(x, _mm256_set1_ps(8));
+			}
+
+			for (int i = 0; i < 3; i++) {
+				segment[i] += setup.edgeA[i] * RASTERIZER_SEGMENT;
+			}
+		}
+
+		for (int i = 0; i < 3; i++) {
+			row[i] += setup.edgeB[i];
+		}
+	}
+	return written;
+}
+
+/**
+ * @brief find the farthest depth of a rectangle of the depth buffer, 8 pixels at once
+ * 
+ * @see Rasterizer::farthestDepthScalar
+ */
+float Rasterizer::farthestDepth(const float *zBuffer, unsigned stride, int minX, int maxX, int minY, int maxY) {
+	if (maxX - minX != 7) {
+		return Rasterizer::farthestDepthScalar(zBuffer, stride, minX, maxX, minY, maxY);
+	}
+	__m256 depth = _mm256_loadu_ps(zBuffer + minY * stride + minX);
+	for (int y = minY + 1; y <= maxY; y++) {
+		depth = _mm256_min_ps(depth, _mm256_loadu_ps(zBuffer + y * stride + minX));
+	}
+	__m128 half = _mm_min_ps(_mm256_castps256_ps128(depth), _mm256_extractf128_ps(depth, 1));
+	half = _mm_min_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_min_ss(half, _mm_shuffle_ps(half, half, 1));
+	return _mm_cvtss_f32(half);
+}
+
+#elif defined(__SSE2__)
+
+/**
+ * @brief rasterize 4 pixels at once, the row tail is handled by the scalar loop
+ * 
+ * @see Rasterizer::rasterizeScalar
+ */
+template <typename Shader>
+unsigned Rasterizer::rasterizeSIMD(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	if (!setup.narrowSteps) {
+		return Rasterizer::rasterizeScalar(setup, shader, pixels, zBuffer, stride);
+	}
+
+	const __m128i minusOne = _mm_set1_epi32(-1);
+	const __m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+	const __m128 az = _mm_set1_ps(setup.depthA);
+	__m128i laneOffset[3], step[3];
+	for (int i = 0; i < 3; i++) {
+		int32_t a = setup.edgeA[i];
+		laneOffset[i] = _mm_setr_epi32(0, a, a * 2, a * 3);
+		step[i] = _mm_set1_epi32(a * 4);
+	}
+	unsigned written = 0;
+
+	TriangleSetup tail = setup;
+	int64_t row[3];
+	for (int i = 0; i < 3; i++) {
+		row[i] = setup.edgeA[i] * setup.minX + setup.edgeB[i] * setup.minY + setup.edgeC[i];
+	}
+
+	for (int y = setup.minY; y <= setup.maxY; y++) {
+		int minX = setup.minX, maxX = setup.maxX;
+		Rasterizer::rowSpan(setup, y, minX, maxX);
+		int64_t segment[3];
+		for (int i = 0; i < 3; i++) {
+			segment[i] = row[i] + setup.edgeA[i] * (minX - setup.minX);
+		}
+		const __m128 cz = _mm_set1_ps(setup.depthB * y + setup.depthC);
+		shader.row(y);
+
+		int px = minX;
+		for (int start = minX; start + 3 <= maxX; start += RASTERIZER_SEGMENT) {
+			__m128i w1 = _mm_add_epi32(_mm_set1_epi32(clampEdge(segment[0])), laneOffset[0]);
+			__m128i w2 = _mm_add_epi32(_mm_set1_epi32(clampEdge(segment[1])), laneOffset[1]);
+			__m128i w3 = _mm_add_epi32(_mm_set1_epi32(clampEdge(segment[2])), laneOffset[2]);
+			__m128 x = _mm_add_ps(_mm_set1_ps(start), lanes);
+
+			unsigned int index = y * stride + start;
+			for (px = start; px <= start + RASTERIZER_SEGMENT - 4 && px + 3 <= maxX; px += 4, index += 4) {
+				__m128i inside = _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(w1, w2), w3), minusOne);
+
+				if (_mm_movemask_epi8(inside) != 0) {
+					__m128 mask = _mm_castsi128_ps(inside);
+					__m128 z = _mm_add_ps(_mm_mul_ps(az, x), cz);
+					__m128 oldZ = _mm_loadu_ps(zBuffer + index);
+					mask = _mm_and_ps(mask, _mm_cmpgt_ps(z, oldZ));
+
+					int visible = _mm_movemask_ps(mask);
+					if (visible) {
+						_mm_storeu_ps(zBuffer + index, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, oldZ)));
+
+						__m128i *pixelsPtr = (__m128i *)(pixels + index * 4);
+						__m128i colorMask = _mm_castps_si128(mask);
+						__m128i oldPixels = _mm_loadu_si128(pixelsPtr);
+						_mm_storeu_si128(pixelsPtr, _mm_or_si128(_mm_and_si128(colorMask, shader.shade(x, z, visible)), _mm_andnot_si128(colorMask, oldPixels)));
+						written += __builtin_popcount(visible);
+					}
+				}
+
+				w1 = _mm_add_epi32(w1, step[0]);
+				w2 = _mm_add_epi32(w2, step[1]);
+				w3 = _mm_add_epi32(w3, step[2]);
+				x = _mm_add_ps(x, _mm_set1_ps(4));
+			}
+
+			for (int i = 0; i < 3; i++) {
+				segment[i] += setup.edgeA[i] * RASTERIZER_SEGMENT;
+			}
+		}
+
+		if (px <= maxX) {
+			tail.minX = px;
+			tail.maxX = maxX;
+			tail.minY = tail.maxY = y;
+			written += Rasterizer::rasterizeScalar(tail, shader, pixels, zBuffer, stride);
+		}
+
+		for (int i = 0; i < 3; i++) {
+			row[i] += setup.edgeB[i];
+		}
+	}
+	return written;
+}
+
+/**
+ * @brief find the farthest depth of a rectangle of the depth buffer, 4 pixels at once
+ * 
+ * @see Rasterizer::farthestDepthScalar
+ */
+float Rasterizer::farthestDepth(const float *zBuffer, unsigned stride, int minX, int maxX, int minY, int maxY) {
+	if (maxX - minX != 7) {
+		return Rasterizer::farthestDepthScalar(zBuffer, stride, minX, maxX, minY, maxY);
+	}
+	__m128 depth = _mm_min_ps(_mm_loadu_ps(zBuffer + minY * stride + minX), _mm_loadu_ps(zBuffer + minY * stride + minX + 4));
+	for (int y = minY + 1; y <= maxY; y++) {
+		depth = _mm_min_ps(depth, _mm_loadu_ps(zBuffer + y * stride + minX));
+		depth = _mm_min_ps(depth, _mm_loadu_ps(zBuffer + y * stride + minX + 4));
+	}
+	depth = _mm_min_ps(depth, _mm_movehl_ps(depth, depth));
+	depth = _mm_min_ss(depth, _mm_shuffle_ps(depth, depth, 1));
+	return _mm_cvtss_f32(depth);
+}
+
+#else
+
+/**
+ * @brief no vector instruction set available, fall back to the scalar kernel
+ * 
+ * @see Rasterizer::rasterizeScalar
+ */
+template <typename Shader>
+unsigned Rasterizer::rasterizeSIMD(const TriangleSetup &setup, Shader &shader, uint8_t *pixels, float *zBuffer, unsigned stride) {
+	return Rasterizer::rasterizeScalar(setup, shader, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief no vector instruction set available, fall back to the scalar search
+ * 
+ * @see Rasterizer::farthestDepthScalar
+ */
+float Rasterizer::farthestDepth(const float *zBuffer, unsigned stride, int minX, int maxX, int minY, int maxY) {
+	return Rasterizer::farthestDepthScalar(zBuffer, stride, minX, maxX, minY, maxY);
+}
+
+#endif
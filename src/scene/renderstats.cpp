@@ -0,0 +1,48 @@
+#include "scene/renderstats.hpp"
+
+RenderStats::RenderStats() :
+	triangles(0),
+	rejectedTriangles(0),
+	blocks(0),
+	rejectedBlocks(0),
+	testedPixels(0),
+	passedPixels(0),
+	writtenPixels(0),
+	sizes(),
+	shapes(0),
+	culledShapes(0)
+{}
+
+RenderStats& RenderStats::operator+=(const RenderStats& other) {
+	this->triangles += other.triangles;
+	this->rejectedTriangles += other.rejectedTriangles;
+	this->blocks += other.blocks;
+	this->rejectedBlocks += other.rejectedBlocks;
+	this->testedPixels += other.testedPixels;
+	this->passedPixels += other.passedPixels;
+	this->writtenPixels += other.writtenPixels;
+	for (int i = 0; i < TRIANGLE_SIZE_COUNT; i++) {
+		this->sizes[i] += other.sizes[i];
+	}
+	this->shapes += other.shapes;
+	this->culledShapes += other.culledShapes;
+	return *this;
+}
+
+/**
+ * @brief ratio of triangle and tile pairs rejected before any block work
+ * 
+ * @return float the reject rate between 0 and 1
+ */
+float RenderStats::triangleRejectRate() const {
+	return this->triangles == 0 ? 0 : (float)this->rejectedTriangles / this->triangles;
+}
+
+/**
+ * @brief ratio of 8x8 blocks rejected before any pixel work
+ * 
+ * @return float the reject rate between 0 and 1
+ */
+float RenderStats::blockRejectRate() const {
+	return this->blocks == 0 ? 0 : (float)this->rejectedBlocks / this->blocks;
+}
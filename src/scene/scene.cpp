@@ -5,21 +5,44 @@ Scene::Scene(unsigned width, unsigned height, float fov, float near, float far)
 	normals(false),
 	faces(true),
 	zbuffer(false),
+	overdraw(false),
+	simd(true),
+	hiz(false),
+	culling(true),
+	gouraud(false),
+	visibility(false),
+	pipelined(false),
+	lod(true),
+	order(DRAW_SUBMITTED),
 	normalLength(1.0f),
 	width(width),
 	height(height),
 	fov(fov),
 	near(near),
-	far(far)
+	far(far),
+	lightRevision(0),
+	instanceBvhValid(false),
+	rasterPending(false),
+	rasterRunning(false),
+	rasterStopping(false),
+	pool(new ThreadPool())
 {
 	this->computeProjectionMatrix();
 	this->worldStateMatrix = Matrix4::identity();
+	this->setLight(Vector3f(0, -1, 1), 0.2);
 	this->initPixelsBuffers();
 }
 
 Scene::~Scene() {
-	delete[] this->pixels;
-	delete[] this->zBuffer;
+	this->finish();
+	if (this->rasterThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(this->rasterMutex);
+			this->rasterStopping = true;
+		}
+		this->rasterCondition.notify_all();
+		this->rasterThread.join();
+	}
 }
 
 /**
@@ -27,22 +50,19 @@ Scene::~Scene() {
  * 
  */
 void Scene::initPixelsBuffers() {
-	int pixelsCount = this->width * this->height;
-	// init pixel buffer
-	this->pixels = new sf::Uint8[pixelsCount * 4];
-	for (int i = 0; i < pixelsCount * 4; i++) {
-		this->pixels[i] = 255;
-	}
+	this->framebuffer.resize(this->width, this->height);
+	this->framebuffer.fill(Color::White);
 
-	this->texture.create(this->width, this->height);
-	this->texture.update(this->pixels);
-	this->sprite.setTexture(this->texture);
+	// initialize tiles
+	this->tilesX = (this->width + TILE_SIZE - 1) / TILE_SIZE;
+	this->tilesY = (this->height + TILE_SIZE - 1) / TILE_SIZE;
+	this->tileDepth.assign(this->tilesX * this->tilesY, 0);
+	this->tileStats.resize(this->tilesX * this->tilesY);
 
-	// initialize z-buffer
-	this->zBuffer = new float[pixelsCount];
-	for (int i = 0; i < pixelsCount; i++) {
-		this->zBuffer[i] = 0;
-	}
+	// initialize hierarchical z-buffer
+	this->blocksX = (this->width + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+	this->blocksY = (this->height + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+	this->blockDepth.assign(this->blocksX * this->blocksY, 0);
 }
 
 /**
@@ -52,6 +72,7 @@ void Scene::initPixelsBuffers() {
  * @param height render height
  */
 void Scene::resize(unsigned width, unsigned height){
+	this->finish();
 	this->width = width;
 	this->height = height;
 	this->initPixelsBuffers();
@@ -64,10 +85,46 @@ void Scene::resize(unsigned width, unsigned height){
  * @param fov the value to set
  */
 void Scene::setFov(float fov) {
+	this->finish();
 	this->fov = fov;
 	this->computeProjectionMatrix();
 }
 
+/**
+ * @brief set the number of threads used to rasterize the scene
+ * 
+ * in pipelined mode the triangles of a frame are set up by half as many other
+ * threads while the previous frame is rasterized
+ * 
+ * @param threads the thread count, the calling thread included
+ */
+void Scene::setThreadCount(unsigned threads) {
+	this->finish();
+	this->pool.reset(new ThreadPool(threads));
+	this->geometryPool.reset();
+}
+
+/**
+ * @brief get the pool setting up the triangles of the pipelined frames, created on first use
+ * 
+ * @return ThreadPool& a pool with half the threads of the raster pool, the submitting thread included
+ */
+ThreadPool &Scene::getGeometryPool() {
+	if (!this->geometryPool) {
+		this->geometryPool.reset(new ThreadPool(std::max(1u, this->pool->getThreadCount() / 2)));
+	}
+	return *this->geometryPool;
+}
+
+/**
+ * @brief get the number of threads used to rasterize the scene
+ * 
+ * @return unsigned the thread count
+ */
+unsigned Scene::getThreadCount() const {
+	return this->pool->getThreadCount();
+}
+
 /**
  * @brief set camera based on pos and lookat pos
  * 
@@ -100,12 +157,26 @@ void Scene::setCamera(const Vector3f pos, const float theta, const float phi, co
 	this->computeCameraLookAt();
 }
 
+/**
+ * @brief set the directional light used by Gouraud shading
+ * 
+ * @param direction the direction the light travels in, in world space
+ * @param ambient the light intensity received by surfaces facing away from the light, in [0, 1]
+ */
+void Scene::setLight(const Vector3f direction, float ambient) {
+	this->lightDirection = direction;
+	this->lightDirection.normalize();
+	this->ambient = ambient;
+	this->lightRevision++;
+}
+
 /**
  * @brief compute projection matrix based on the scene parameters
  * 
  */
 void Scene::computeProjectionMatrix() {
 	this->projectionMatrix = Matrix4::projectionMatrix(this->fov, this->width / this->height, this->near, this->far);
+	this->computeClipPlanes();
 }
 
 
@@ -188,342 +259,2262 @@ void Scene::rotate(float x, float y, float z) {
 	this->rotate(Vector3f(x, y, z));
 }
 
+namespace {
+
+/**
+ * @brief give the triangle color to each of its vertices
+ * 
+ * @param color the triangle color
+ * @param varyings the vertex attributes to fill
+ */
+void flatVaryings(const Color &color, TriangleVaryings &varyings) {
+	for (int i = 0; i < 3; i++) {
+		varyings.values[i][0] = color.r;
+		varyings.values[i][1] = color.g;
+		varyings.values[i][2] = color.b;
+	}
+	varyings.texture = nullptr;
+}
+
+/**
+ * @brief check if a triangle is clearly seen from behind
+ * 
+ * @param vertex a vertex of the triangle
+ * @param normal the face normal of the triangle, (v2 - v1) x (v3 - v1), a null one is never culled
+ * @param eye the point the triangle is seen from, in the same space
+ * @return bool true if the normal points away from the eye by more than BACKFACE_MARGIN
+ */
+inline bool facesAway(const Vector3f &vertex, const Vector3f &normal, const Vector3f &eye) {
+	float x = vertex.x - eye.x, y = vertex.y - eye.y, z = vertex.z - eye.z;
+	float dot = normal.x * x + normal.y * y + normal.z * z;
+	if (!(dot > 0)) {
+		return false;
+	}
+	float normalLength = normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
+	return dot * dot > BACKFACE_MARGIN * normalLength * (x * x + y * y + z * z);
+}
+
+/**
+ * @brief list the triangles of a stream not clearly seen from behind, as facesAway() does
+ * 
+ * the loop has no branch: each index is written after the last kept one and the
+ * count only moves past it if the triangle is kept
+ * 
+ * @param triangles the triangles to test
+ * @param normals x, y and z of the face normal of each triangle, (v2 - v1) x (v3 - v1)
+ * @param eye the point the triangles are seen from
+ * @param front filled with the indices of the triangles to keep, room for all of them is needed
+ * @return unsigned the number of kept triangles
+ */
+unsigned selectFrontFaces(const TriangleStream &triangles, const AlignedFloats *normals, const Vector3f &eye, uint32_t *front) {
+	const float *vertexX = triangles.x[0].data(), *vertexY = triangles.y[0].data(), *vertexZ = triangles.z[0].data();
+	const float *normalX = normals[0].data(), *normalY = normals[1].data(), *normalZ = normals[2].data();
+	unsigned count = triangles.size(), kept = 0;
+	for (unsigned i = 0; i < count; i++) {
+		float x = vertexX[i] - eye.x, y = vertexY[i] - eye.y, z = vertexZ[i] - eye.z;
+		float dot = normalX[i] * x + normalY[i] * y + normalZ[i] * z;
+		float normalLength = normalX[i] * normalX[i] + normalY[i] * normalY[i] + normalZ[i] * normalZ[i];
+		bool away = dot > 0 && dot * dot > BACKFACE_MARGIN * normalLength * (x * x + y * y + z * z);
+		front[kept] = i;
+		kept += !away;
+	}
+	return kept;
+}
+
+/**
+ * @brief sort integers by a bit field with a least significant digit radix sort, 8 bits per pass
+ * 
+ * the sort is stable: the items with the same key keep their order, the passes
+ * where all the items have the same digit are skipped
+ * 
+ * @param items the items to sort
+ * @param scratch a list swapped with the items between passes
+ * @param firstBit the lowest bit of the key in the items
+ * @param bits the number of bits of the key
+ */
+void radixSort(std::vector<uint64_t> &items, std::vector<uint64_t> &scratch, unsigned firstBit, unsigned bits) {
+	scratch.resize(items.size());
+	for (unsigned shift = firstBit; shift < firstBit + bits; shift += 8) {
+		unsigned offsets[256] = {0};
+		for (uint64_t item : items) {
+			offsets[(item >> shift) & 0xff]++;
+		}
+		if (offsets[(items[0] >> shift) & 0xff] == items.size()) {
+			continue;
+		}
+		unsigned total = 0;
+		for (unsigned &offset : offsets) {
+			unsigned digitCount = offset;
+			offset = total;
+			total += digitCount;
+		}
+		for (uint64_t item : items) {
+			scratch[offsets[(item >> shift) & 0xff]++] = item;
+		}
+		items.swap(scratch);
+	}
+}
+
+/**
+ * @brief put a matrix back to the value it had when the guard was created once the guard goes out of scope
+ * 
+ */
+class MatrixRestorer {
+	public:
+		MatrixRestorer(Matrix4 &matrix) : matrix(matrix), saved(matrix) {}
+		~MatrixRestorer() {
+			this->matrix = this->saved;
+		}
+
+		MatrixRestorer(const MatrixRestorer&) = delete;
+		MatrixRestorer& operator=(const MatrixRestorer&) = delete;
+
+	private:
+		Matrix4 &matrix;
+		Matrix4 saved;
+};
+
+}
+
 /**
  * @brief add a shape to the scene
  * 
+ * shapes outside the view frustum are rejected first, the others providing
+ * a mesh go through the indexed vertex stage and the rest through their triangle list
+ * 
  * @param shape any shape that inherits from Shape
  */
 void Scene::drawShape(Shape *shape) {
-	std::vector <Triangle> triangles = shape->getTriangles();
-	std::vector <sf::Color> colors = shape->getColors();
+	const ShapeBounds &bounds = shape->getBounds();
+	LevelKey key = {shape, this->countCopies(shape, 1)};
+	if (this->addInstance(shape, bounds, this->worldStateMatrix)) {
+		this->submitShape(shape, this->selectLevel(shape, bounds, this->worldStateMatrix, key), this->culling);
+	}
+}
 
-	if (triangles.size() != colors.size()) {
-		throw std::runtime_error("triangles and colors size mismatch");
+/**
+ * @brief add copies of a shape to the scene, each one placed by its own matrix
+ * 
+ * the mesh or the triangle list of the shape is read once and shared by all the
+ * copies, each copy is culled and streamed through the vertex stage with the current
+ * world matrix times its matrix, without going through the matrix stack
+ * 
+ * the copies whose matrix cannot be inverted are flattened onto a plane, a line
+ * or a point and are skipped, the current world matrix is restored on return
+ * 
+ * @param shape any shape that inherits from Shape
+ * @param matrices the matrix of each copy, applied after the current world matrix
+ * @param count the number of copies
+ */
+void Scene::drawInstanced(Shape *shape, const Matrix4 *matrices, unsigned count) {
+	const ShapeBounds &bounds = shape->getBounds();
+	const Mesh *mesh = shape->getMesh();
+	std::vector<Triangle> triangles;
+	std::vector<Color> colors;
+	std::vector<std::shared_ptr<const Texture>> textures;
+	if (!mesh) {
+		triangles = shape->getTriangles();
+		colors = shape->getColors();
+		textures = shape->getTextures();
 	}
 
-	for (Triangle &t : triangles) {
-		for (int i = 0; i < 3; i++) {
-			t(i) = this->worldStateMatrix * t.at(i);
+	// the world matrix of each copy replaces the current one until the function leaves, even by an exception
+	const Matrix4 base = this->worldStateMatrix;
+	MatrixRestorer restorer(this->worldStateMatrix);
+	unsigned firstCopy = this->countCopies(shape, count);
+	for (unsigned i = 0; i < count; i++) {
+		this->worldStateMatrix = base * matrices[i];
+		Vector3f eye;
+		if (!this->getShapeEye(eye)) {
+			continue;
+		}
+		if (!this->addInstance(shape, bounds, this->worldStateMatrix)) {
+			continue;
+		}
+		const Vector3f *cullingEye = this->culling ? &eye : nullptr;
+		if (mesh) {
+			this->drawMesh(*this->selectLevel(shape, bounds, this->worldStateMatrix, {shape, firstCopy + i}), cullingEye);
+		} else {
+			this->drawTriangles(triangles, colors, textures, cullingEye);
 		}
-		this->triangles.push_back(t);
 	}
-
-	this->colors.insert(this->colors.end(), colors.begin(), colors.end());
 }
 
 /**
- * @brief check if a triangle is visible or not based on camera position
+ * @brief count a drawn shape and keep its world bounding box for picking
  * 
- * @param triangle triangle to check
- * @return bool if the triangle is visible or not
+ * @param shape the drawn shape
+ * @param bounds its bounding volumes
+ * @param matrix the world matrix of the shape
+ * @return bool false if the culling rejected it, true if its triangles must be submitted
  */
-inline bool Scene::isVisible(const Triangle &triangle) const {
-	return triangle.getNormal().dot(triangle.v1) < 0;
+bool Scene::addInstance(Shape *shape, const ShapeBounds &bounds, const Matrix4 &matrix) {
+	this->geometry.shapes++;
+	if (bounds.radius >= 0) {
+		// box of the transformed box: its center moved and its half extent through the absolute matrix
+		const Matrix4 &m = matrix;
+		Vector3f center = m * ((bounds.min + bounds.max) * 0.5f);
+		Vector3f half = (bounds.max - bounds.min) * 0.5f;
+		Vector3f extent(
+			std::abs(m.at(0, 0)) * half.x + std::abs(m.at(0, 1)) * half.y + std::abs(m.at(0, 2)) * half.z,
+			std::abs(m.at(1, 0)) * half.x + std::abs(m.at(1, 1)) * half.y + std::abs(m.at(1, 2)) * half.z,
+			std::abs(m.at(2, 0)) * half.x + std::abs(m.at(2, 1)) * half.y + std::abs(m.at(2, 2)) * half.z
+		);
+		this->geometry.instances.push_back({shape, m, BoundingBox(center - extent, center + extent)});
+	}
+	if (this->culling && this->isOutsideFrustum(bounds, matrix)) {
+		this->geometry.culledShapes++;
+		return false;
+	}
+	return true;
 }
 
 /**
- * @brief change camera coordinate to put camera in the center of the world
+ * @brief get the camera position in the space of the shapes drawn with the current world matrix
+ * 
+ * a singular world matrix flattens the shape, there is no such position and
+ * the back facing triangles are left to the clipper
  * 
- * @param triangle triangle to moove
+ * @param eye set to the point the back facing triangles are culled from
+ * @return bool false if the world matrix cannot be inverted
  */
-void Scene::setTrianglePosFromCamera(Triangle &triangle) const {
-	for (int i = 0; i < 3; i++) {
-		triangle(i) = this->cameraLookAtMatrix * triangle.at(i);
+bool Scene::getShapeEye(Vector3f &eye) const {
+	Matrix4 toShape;
+	if (!this->worldStateMatrix.inverse(toShape)) {
+		return false;
 	}
-	triangle.calculateNormal();
+	eye = toShape * this->cameraPosition;
+	return true;
 }
 
 /**
- * @brief project a 3d vector to 2d projection vector
+ * @brief count copies of a shape drawn out of the scene graph, which tells them apart between frames
  * 
- * @param vector the vector to project
- * @return sf::Vector2f the projected vector
+ * the copies of a shape keep their levels of detail as long as the shape is drawn
+ * the same number of times before them in each frame, whatever the other shapes do
+ * 
+ * @param shape the drawn shape
+ * @param count the number of copies
+ * @return unsigned the number of copies of the shape drawn before them in the frame
  */
-sf::Vector2f Scene::getProjection(Vector3f vector) const {
-	vector = this->projectionMatrix * vector;
-	vector.x += 1;
-	vector.y += 1;
-	vector.x *= this->width / 2;
-	vector.y *= this->height / 2;
-
-	return sf::Vector2f(vector.x, vector.y);
+unsigned Scene::countCopies(Shape *shape, unsigned count) {
+	if (!this->lod || !shape->getLevel(1)) {
+		return 0;
+	}
+	unsigned &copies = this->shapeCopies[shape];
+	unsigned first = copies;
+	copies += count;
+	return first;
 }
 
 /**
- * @brief clip each triangles of the scene against a plane with equation ax + by + cz + d = 0
+ * @brief choose the level of detail of a shape instance
+ * 
+ * the error of each level is measured in pixels where the bounding sphere of the
+ * shape is the nearest to the camera: the coarsest level under LOD_PIXEL_ERROR is
+ * taken, or, if the instance was submitted with the same shape in the previous frame,
+ * its previous level is kept until it gets LOD_HYSTERESIS times too coarse or too fine
  * 
- * @param planeNormal the vector normal to the plane x, y and z of the vector represents a, b and c
- * @param planeD if the plae is an affine plane, this is the d else set it to 0
+ * @param shape the shape about to be submitted
+ * @param bounds its bounding volumes
+ * @param matrix the world matrix of the shape
+ * @param key the instance the level is kept for until the next frame
+ * @return const Mesh* the mesh to submit, nullptr if the shape has no mesh
  */
-void Scene::clipAgainstPlane(const Vector3f &planeNormal, const float &planeD) {
-	std::vector<Triangle> renderTriangles;
-	std::vector<sf::Color> renderColors;
-	for (long unsigned int i = 0; i < this->triangles.size(); i++) {
-		if (isVisible(this->triangles[i])) {
-			this->clipTriangle(
-				this->triangles[i], this->colors[i],
-				planeNormal, planeD,
-				renderTriangles, renderColors
-			);
+const Mesh *Scene::selectLevel(Shape *shape, const ShapeBounds &bounds, const Matrix4 &matrix, const LevelKey &key) {
+	const Mesh *mesh = shape->getMesh();
+	if (!this->lod || !mesh || bounds.radius < 0 || !shape->getLevel(1)) {
+		return mesh;
+	}
+	Matrix4 toCamera = this->cameraLookAtMatrix * matrix;
+	float scale = 0;
+	for (int column = 0; column < 3; column++) {
+		Vector3f axis(toCamera.at(0, column), toCamera.at(1, column), toCamera.at(2, column));
+		scale = std::max(scale, axis.length());
+	}
+	Vector3f center = toCamera * bounds.center;
+	float depth = center.z - bounds.radius * scale;
+	if (depth <= this->near) {
+		this->shapeLevels[key] = {shape, 0};
+		return mesh;
+	}
+
+	// pixels covered by a unit of shape space at the nearest point of the sphere
+	const Matrix4 &m = this->projectionMatrix;
+	float w = std::abs(m.at(3, 2) * depth + m.at(3, 3));
+	float rowX = Vector3f(m.at(0, 0), m.at(0, 1), m.at(0, 2)).length() * this->width / 2;
+	float rowY = Vector3f(m.at(1, 0), m.at(1, 1), m.at(1, 2)).length() * this->height / 2;
+	float pixels = std::max(rowX, rowY) * scale / w;
+	auto pixelError = [shape, pixels](unsigned level) {
+		const Mesh *levelMesh = shape->getLevel(level);
+		return levelMesh ? levelMesh->error * pixels : std::numeric_limits<float>::infinity();
+	};
+
+	unsigned level = 0;
+	auto found = this->lastShapeLevels.find(key);
+	const std::pair<Shape*, unsigned> *last = found != this->lastShapeLevels.end() ? &found->second : nullptr;
+	if (last && last->first == shape && shape->getLevel(last->second)) {
+		level = last->second;
+		while (level > 0 && pixelError(level) > LOD_PIXEL_ERROR * LOD_HYSTERESIS) {
+			level--;
+		}
+		while (pixelError(level + 1) < LOD_PIXEL_ERROR / LOD_HYSTERESIS) {
+			level++;
+		}
+	} else {
+		while (pixelError(level + 1) <= LOD_PIXEL_ERROR) {
+			level++;
 		}
 	}
-	this->triangles.clear();
-	this->colors.clear();
-	this->triangles = renderTriangles;
-	this->colors = renderColors;
+	this->shapeLevels[key] = {shape, level};
+	return shape->getLevel(level);
 }
 
 /**
- * @brief clip a triangle against a plane
- *
- * @param triangle the triangle to clip
- * @param color the color of the triangle
- * @see Scene::clipAgainstPlane(const Vector3f &planeNormal, const float &planeD)
- * @param planeNormal the normal vector of the plane
- * @param planeD d coefficient of the plane equation
- * @param renderTriangles all triangles to clip
- * @param renderColors all colors of each triangles
+ * @brief add the triangles of a shape drawn with the current world matrix to the submitted lists
+ * 
+ * the camera is moved to the space of the shape once, so the back facing triangles
+ * are culled with a dot product on their untransformed vertices and never copied,
+ * unless the world matrix is singular
+ * 
+ * @param shape the shape to add
+ * @param mesh the level of detail of the shape to submit, nullptr to submit its triangle list
+ * @param cull skip the back facing triangles and the parts of the mesh outside the view frustum
  */
-void Scene::clipTriangle(
-	const Triangle &triangle, const sf::Color &color,
-	const Vector3f &planeNormal, const float &planeD,
-	std::vector<Triangle> &renderTriangles, std::vector<sf::Color> &renderColors
-) const {
-	int pointIndex, inside;
-	std::tie(pointIndex, inside) = triangle.getDistancesToPlane(planeNormal, planeD);
+void Scene::submitShape(Shape *shape, const Mesh *mesh, bool cull) {
+	Vector3f eye;
+	const Vector3f *cullingEye = cull && this->getShapeEye(eye) ? &eye : nullptr;
 
-	if (inside == 0) { // if the triangle is outside the plane
+	if (mesh) {
+		this->drawMesh(*mesh, cullingEye);
 		return;
 	}
+	this->drawTriangles(shape->getTriangles(), shape->getColors(), shape->getTextures(), cullingEye);
+}
 
-	if (inside == 3) { // if the triangle is inside the plane
-		renderTriangles.push_back(triangle);
-		renderColors.push_back(color);
-		return;
+/**
+ * @brief add a triangle list to the scene
+ * 
+ * the kept triangles are copied then transformed together with the current world matrix
+ * 
+ * @param triangles the triangles to add, in shape space
+ * @param colors the color of each triangle
+ * @param textures the texture of each triangle, empty if they are not textured
+ * @param eye the camera position in shape space, nullptr to keep the back facing triangles
+ */
+void Scene::drawTriangles(const std::vector<Triangle> &triangles, const std::vector<Color> &colors, const std::vector<std::shared_ptr<const Texture>> &textures, const Vector3f *eye) {
+	FrameGeometry &geometry = this->geometry;
+	bool smooth = this->beginShape(triangles.size(), colors.size(), textures.size());
+	unsigned first = geometry.triangles.size();
+	for (unsigned i = 0; i < triangles.size(); i++) {
+		const Triangle &t = triangles[i];
+		if (eye && facesAway(t.v1, t.normal, *eye)) {
+			continue;
+		}
+		if (smooth) {
+			TriangleVaryings varyings;
+			const Texture *texture = textures.empty() ? nullptr : textures[i].get();
+			if (this->gouraud || texture) {
+				float intensities[3] = {1, 1, 1};
+				for (int j = 0; this->gouraud && j < 3; j++) {
+					intensities[j] = this->lightIntensity(this->worldStateMatrix.transformDirection(t.getVertexNormal(j)));
+				}
+				this->lightTriangle(intensities, t.uvs, colors[i], texture, varyings);
+			} else {
+				flatVaryings(colors[i], varyings);
+			}
+			if (texture) {
+				this->addTexture(textures[i]);
+			}
+			geometry.varyings.push_back(varyings);
+		}
+		geometry.triangles.push(t.v1, t.v2, t.v3);
+		geometry.colors.push_back(colors[i]);
 	}
+	geometry.triangles.transform(this->worldStateMatrix, first);
+}
 
-	// if there is points inside and outside the plane
-	for (int i = 0; i < inside; i++) {
-		renderColors.push_back(color);
+/**
+ * @brief add an indexed mesh to the scene
+ * 
+ * the vertex stage transforms, and lights with Gouraud shading, each unique
+ * vertex once into a post-transform cache, the triangles are then assembled
+ * by index from the cached vertices, except the ones the hierarchical culling
+ * found outside the view frustum and the back facing ones
+ * 
+ * @param mesh the mesh to add, in shape space
+ * @param eye the camera position in shape space, nullptr to keep all the triangles
+ */
+void Scene::drawMesh(const Mesh &mesh, const Vector3f *eye) {
+	FrameGeometry &geometry = this->geometry;
+	unsigned count = mesh.triangleCount();
+	bool smooth = this->beginShape(count, mesh.colors.size(), mesh.textures.size());
+	const char *visible = eye && this->cullMesh(mesh) ? this->visibleTriangles.data() : nullptr;
+	if (mesh.faceNormals.size() != count) {
+		eye = nullptr;
 	}
 
-	Vector3f leftPoint, rightPoint;
-	std::tie(leftPoint, rightPoint) = triangle.getLeftRightIntersection(planeNormal, planeD, pointIndex);
+	std::vector<Vector3f> &positions = this->vertexPositions;
+	positions.resize(mesh.positions.size());
+	this->worldStateMatrix.transformPoints(mesh.positions.data(), positions.data(), positions.size(), true);
+	if (this->gouraud) {
+		std::vector<Vector3f> &normals = this->vertexNormals;
+		normals.resize(mesh.normals.size());
+		this->worldStateMatrix.transformDirections(mesh.normals.data(), normals.data(), normals.size());
+		this->vertexLight.resize(normals.size());
+		for (unsigned i = 0; i < normals.size(); i++) {
+			const Vector3f &normal = normals[i];
+			// vertices without a normal are lit with the normal of each of their triangles
+			bool known = normal.x != 0 || normal.y != 0 || normal.z != 0;
+			this->vertexLight[i] = known ? this->lightIntensity(normal) : -1;
+		}
+	}
 
-	// clip triangle
-	if (inside == 1) {
-		renderTriangles.push_back(Triangle(triangle.at(pointIndex), leftPoint,  rightPoint, triangle.getNormal()));
-		return;
+	for (unsigned i = 0; i < count; i++) {
+		if (visible && !visible[i]) {
+			continue;
+		}
+		if (eye && facesAway(mesh.positions[mesh.indices[i * 3]], mesh.faceNormals[i], *eye)) {
+			continue;
+		}
+		const uint32_t *corners = &mesh.indices[i * 3];
+		const Vector3f &v1 = positions[corners[0]];
+		const Vector3f &v2 = positions[corners[1]];
+		const Vector3f &v3 = positions[corners[2]];
+		if (smooth) {
+			TriangleVaryings varyings;
+			const Texture *texture = mesh.textures.empty() ? nullptr : mesh.textures[i].get();
+			if (this->gouraud || texture) {
+				float intensities[3] = {1, 1, 1};
+				Vector2f uvs[3];
+				for (int j = 0; j < 3; j++) {
+					if (this->gouraud) {
+						intensities[j] = this->vertexLight[corners[j]];
+					}
+					if (intensities[j] < 0) {
+						intensities[j] = this->lightIntensity((v2 - v1).cross(v3 - v1));
+					}
+					uvs[j] = mesh.uvs[corners[j]];
+				}
+				this->lightTriangle(intensities, uvs, mesh.colors[i], texture, varyings);
+			} else {
+				flatVaryings(mesh.colors[i], varyings);
+			}
+			if (texture) {
+				this->addTexture(mesh.textures[i]);
+			}
+			geometry.varyings.push_back(varyings);
+		}
+		geometry.triangles.push(v1, v2, v3);
+		geometry.colors.push_back(mesh.colors[i]);
 	}
+}
 
-	renderTriangles.push_back(Triangle(leftPoint, triangle.at((pointIndex + 1) % 3), triangle.at((pointIndex + 2) % 3), triangle.getNormal()));
-	renderTriangles.push_back(Triangle(leftPoint, triangle.at((pointIndex + 2) % 3), rightPoint, triangle.getNormal()));
+/**
+ * @brief add a node of a retained scene graph and its subtree to the scene
+ * 
+ * the world matrices of the nodes replace the current world matrix, each shape
+ * is transformed and lit once then its world space triangles are kept by its node
+ * and copied into the next frames as long as the node, its shape and the light
+ * do not change, the nodes outside the view frustum are rejected with the bounding
+ * box of their triangles
+ * 
+ * @param node the root of the subtree to draw
+ */
+void Scene::drawNode(SceneNode *node) {
+	if (node->getShape()) {
+		this->drawCachedShape(node);
+	}
+	for (const std::unique_ptr<SceneNode> &child : node->getChildren()) {
+		this->drawNode(child.get());
+	}
 }
 
 /**
- * @brief calculate one of tree baricentric coordinates of a point in a triangle
+ * @brief add the cached triangles of a node to the submitted lists, after building them if they are out of date
  * 
- * @param p1 one point of the triangle
- * @param p2 point after p1 in clockwise order
- * @param p3 point to check
- * @return float the barycentric component of p1
+ * the node is culled with the bounds of its shape first, so the cache of a node
+ * out of the view is not built, then with the box of its cached triangles
+ * 
+ * @param node a node with a shape
  */
-float Scene::edgeFunction(const sf::Vector2f &p1, const sf::Vector2f &p2, const sf::Vector2f &p3) const {
-	return ((p3.x - p1.x) * (p2.y - p1.y) - (p3.y - p1.y) * (p2.x - p1.x));
+void Scene::drawCachedShape(SceneNode *node) {
+	FrameGeometry &geometry = this->geometry;
+	const Matrix4 &matrix = node->getWorldMatrix();
+	NodeGeometry &cache = node->geometry;
+	Shape *shape = node->getShape();
+	const ShapeBounds &bounds = shape->getBounds();
+	if (!this->addInstance(shape, bounds, matrix)) {
+		return;
+	}
+	unsigned revision = shape->getRevision();
+	const Mesh *mesh = this->selectLevel(shape, bounds, matrix, {node, 0});
+	if (
+		!cache.valid || cache.shapeRevision != revision || cache.lightRevision != this->lightRevision ||
+		cache.gouraud != this->gouraud || cache.mesh != mesh
+	) {
+		this->cacheShape(node, mesh);
+	}
+	if (cache.bounds.empty()) {
+		return;
+	}
+	if (bounds.radius < 0) {
+		// a shape without bounds is only picked with the box of its cached triangles
+		geometry.instances.push_back({shape, matrix, cache.bounds});
+	}
+	if (this->culling && this->isOutsideFrustum(cache.bounds)) {
+		geometry.culledShapes++;
+		return;
+	}
+
+	unsigned count = cache.triangles.size();
+	// cached varyings make the frame smooth shaded as the varyings of a textured shape do
+	bool smooth = this->beginShape(count, cache.colors.size(), cache.varyings.empty() ? 0 : cache.varyings.size());
+	// indices of the triangles to copy, all of them without culling
+	std::vector<uint32_t> &selected = this->selectedTriangles;
+	selected.resize(count);
+	if (this->culling) {
+		selected.resize(selectFrontFaces(cache.triangles, cache.normals, this->cameraPosition, selected.data()));
+	} else {
+		std::iota(selected.begin(), selected.end(), 0);
+	}
+
+	geometry.triangles.append(cache.triangles, selected.data(), selected.size());
+	unsigned first = geometry.colors.size();
+	geometry.colors.resize(first + selected.size());
+	for (unsigned i = 0; i < selected.size(); i++) {
+		geometry.colors[first + i] = cache.colors[selected[i]];
+	}
+	if (smooth) {
+		for (uint32_t i : selected) {
+			if (cache.varyings.empty()) {
+				TriangleVaryings varyings;
+				flatVaryings(cache.colors[i], varyings);
+				geometry.varyings.push_back(varyings);
+			} else {
+				geometry.varyings.push_back(cache.varyings[i]);
+			}
+		}
+	}
+	for (const std::shared_ptr<const Texture> &texture : cache.textures) {
+		this->addTexture(texture);
+	}
 }
 
 /**
- * @brief calculate z-index of a pixel based on barrycentric coordinates
+ * @brief transform and light all the triangles of the shape of a node into its cache
+ * 
+ * the shape is submitted with the world matrix of the node to lists of its own, without
+ * culling, then the lists are swapped with the ones of the cache
  * 
- * @param w1 first barrycentric coordinate
- * @param w2 second barrycentric coordinate
- * @param w3 third barrycentric coordinate
- * @param v1 first point of the triangle
- * @param v2 second point of the triangle
- * @param v3 third point of the triangle
- * @return float the z-index for the given pixel
+ * @param node a node with a shape
+ * @param mesh the level of detail of the shape, nullptr if it has no mesh
  */
-float Scene::computeZIndex(float w1, float w2, float w3, Vector3f v1, Vector3f v2, Vector3f v3) {
-	float z =  1 / (w1 * v1.z + w2 * v2.z  + w3 * v3.z); // compute z-index
-	if (z > this->maxZ) {
-		this->maxZ = z;
+void Scene::cacheShape(SceneNode *node, const Mesh *mesh) {
+	NodeGeometry &cache = node->geometry;
+	Shape *shape = node->getShape();
+	Matrix4 savedMatrix = this->worldStateMatrix;
+	this->worldStateMatrix = node->getWorldMatrix();
+	std::swap(this->geometry, this->nodeGeometry);
+	FrameGeometry &lists = this->geometry;
+	lists.triangles.clear();
+	lists.colors.clear();
+	lists.varyings.clear();
+	lists.textures.clear();
+	lists.shapeStarts.clear();
+	this->submitShape(shape, mesh, false);
+	std::swap(this->geometry, this->nodeGeometry);
+	this->worldStateMatrix = savedMatrix;
+
+	FrameGeometry &built = this->nodeGeometry;
+	cache.triangles.swap(built.triangles);
+	cache.colors.swap(built.colors);
+	cache.varyings.swap(built.varyings);
+	cache.textures.swap(built.textures);
+	cache.bounds = BoundingBox();
+	for (AlignedFloats &normals : cache.normals) {
+		normals.resize(cache.triangles.size());
 	}
-	if (z < this->minZ) {
-		this->minZ = z;
+	for (unsigned i = 0; i < cache.triangles.size(); i++) {
+		Vector3f vertices[3];
+		cache.triangles.getTriangle(i, vertices);
+		for (const Vector3f &vertex : vertices) {
+			cache.bounds.grow(vertex);
+		}
+		Vector3f normal = (vertices[1] - vertices[0]).cross(vertices[2] - vertices[0]);
+		cache.normals[0][i] = normal.x;
+		cache.normals[1][i] = normal.y;
+		cache.normals[2][i] = normal.z;
 	}
-	return z;
+	cache.valid = true;
+	cache.shapeRevision = shape->getRevision();
+	cache.lightRevision = this->lightRevision;
+	cache.gouraud = this->gouraud;
+	cache.mesh = mesh;
 }
 
 /**
- * @brief draw a triangle to the screen
+ * @brief check the lists of a shape and prepare the frame varyings for it
  * 
- * @param t the triangle to draw
- * @param color the triangle color
+ * the frame is smooth shaded from the first shape submitted with Gouraud shading or a texture,
+ * the triangles submitted before keep their flat color, the first triangle of the shape is recorded
+ * for the depth ordering
+ * 
+ * @param triangles the number of triangles of the shape
+ * @param colors the number of triangle colors of the shape
+ * @param textures the number of triangle textures of the shape, 0 if it is not textured
+ * @return bool true if the triangles of the shape need varyings
  */
-void Scene::rasterizeTriangle(const Triangle &t, const sf::Color& color) {
-	Vector3f v1 = t.v1;
-	Vector3f v2 = t.v2;
-	Vector3f v3 = t.v3;
-
-	sf::Vector2f p1 = this->getProjection(v1);
-	sf::Vector2f p2 = this->getProjection(v2);
-	sf::Vector2f p3 = this->getProjection(v3);
-
-	int minX = std::min(p1.x, std::min(p2.x, p3.x));
-	int maxX = std::max(p1.x, std::max(p2.x, p3.x));
-	int minY = std::min(p1.y, std::min(p2.y, p3.y));
-	int maxY = std::max(p1.y, std::max(p2.y, p3.y));
-
-	float w1, w2, w3, area;
-	
-	for (unsigned int x = minX >= 0 ? minX : 0; x <= maxX && x <= this->width; x++) {
-		for (unsigned int y = minY >= 0 ? minY : 0; y <= maxY && y <= this->height; y++) {
-			area = edgeFunction(p1, p2, p3);
-			w1 = edgeFunction(p2, p3, sf::Vector2f(x, y));
-			w2 = edgeFunction(p3, p1, sf::Vector2f(x, y));
-			w3 = edgeFunction(p1, p2, sf::Vector2f(x, y));
-
-			if (w1 >= 0 && w2 >= 0 && w3 >= 0) {
-				w1 /= area;
-				w2 /= area;
-				w3 /= area;
-				float z = computeZIndex(w1, w2, w3, v1, v2, v3);
-				if (z > this->zBuffer[y * this->height + x]) {
-					this->zBuffer[y * height + x] = z;
-					this->pixels[y * this->height * 4 + x * 4 + 0] = color.r;
-					this->pixels[y * this->height * 4 + x * 4 + 1] = color.g;
-					this->pixels[y * this->height * 4 + x * 4 + 2] = color.b;
-					this->pixels[y * this->height * 4 + x * 4 + 3] = 255;
-				}
-			}
+bool Scene::beginShape(unsigned triangles, unsigned colors, unsigned textures) {
+	if (triangles != colors) {
+		throw std::runtime_error("triangles and colors size mismatch");
+	}
+	if (textures != 0 && triangles != textures) {
+		throw std::runtime_error("triangles and textures size mismatch");
+	}
+
+	FrameGeometry &geometry = this->geometry;
+	geometry.shapeStarts.push_back(geometry.triangles.size());
+	bool smooth = this->gouraud || textures != 0 || !geometry.varyings.empty();
+	if (smooth && geometry.varyings.size() < geometry.triangles.size()) {
+		geometry.varyings.resize(geometry.triangles.size());
+		for (unsigned i = 0; i < geometry.triangles.size(); i++) {
+			flatVaryings(geometry.colors[i], geometry.varyings[i]);
 		}
 	}
+	return smooth;
 }
 
 /**
- * @brief draw each triangle of the scene
+ * @brief keep a texture alive until the frame is rasterized
  * 
+ * @param texture the texture of a submitted triangle, ignored if it is the last kept one
  */
-void Scene::drawFaces() {
-	for (long unsigned int  i = 0; i < this->triangles.size(); i++) {
-		this->rasterizeTriangle(this->triangles[i], this->colors[i]);
+void Scene::addTexture(const std::shared_ptr<const Texture> &texture) {
+	std::vector<std::shared_ptr<const Texture>> &textures = this->geometry.textures;
+	if (textures.empty() || textures.back() != texture) {
+		textures.push_back(texture);
 	}
-	
-	this->texture.update(this->pixels);
 }
 
 /**
- * @brief draw the z-buffer to the screen
+ * @brief light intensity of a vertex lit by the scene light
  * 
+ * @param normal the vertex normal in world space, it does not need to be normalized
+ * @return float the ambient light plus the diffuse light, 0 to 1
  */
-void Scene::drawZBuffer() {
-	float zValue;
-	for (unsigned int x = 0; x < this->width; x++) {
-		for (unsigned int y = 0; y < this->height; y++) {
-			zValue = this->zBuffer[y * this->height + x] * 255;
-			this->pixels[y * this->height * 4 + x * 4 + 0] = zValue;
-			this->pixels[y * this->height * 4 + x * 4 + 1] = zValue;
-			this->pixels[y * this->height * 4 + x * 4 + 2] = zValue;
-			this->pixels[y * this->height * 4 + x * 4 + 3] = 255;
+float Scene::lightIntensity(const Vector3f &normal) const {
+	float length = normal.length();
+	float diffuse = length > 0 ? std::max(0.0f, -normal.dot(this->lightDirection) / length) : 0;
+	return this->ambient + (1 - this->ambient) * diffuse;
+}
+
+/**
+ * @brief compute the varyings of each vertex of a lit triangle
+ * 
+ * @param intensities the light intensity of each vertex, 1 without Gouraud shading
+ * @param uvs the texture coordinates of each vertex
+ * @param color the triangle color
+ * @param texture the triangle texture, nullptr if it is not textured
+ * @param varyings the lit color of each vertex, or its texture coordinates and light intensity
+ */
+void Scene::lightTriangle(const float *intensities, const Vector2f *uvs, const Color &color, const Texture *texture, TriangleVaryings &varyings) const {
+	varyings.texture = texture;
+	for (int i = 0; i < 3; i++) {
+		float intensity = intensities[i];
+		if (texture) {
+			varyings.values[i][0] = uvs[i].x;
+			varyings.values[i][1] = uvs[i].y;
+			varyings.values[i][2] = intensity;
+		} else {
+			varyings.values[i][0] = color.r * intensity;
+			varyings.values[i][1] = color.g * intensity;
+			varyings.values[i][2] = color.b * intensity;
 		}
 	}
-	this->texture.update(this->pixels);
 }
 
 /**
- * @brief draw each triangles in wireframe mode 
+ * @brief project a 3d vector to 2d projection vector
+ * 
+ * @param vector the vector to project
+ * @return Vector2f the projected vector
+ */
+Vector2f Scene::getProjection(Vector3f vector) const {
+	vector = this->projectionMatrix * vector;
+	vector.x += 1;
+	vector.y += 1;
+	vector.x *= this->width / 2;
+	vector.y *= this->height / 2;
+
+	return Vector2f(vector.x, vector.y);
+}
+
+namespace {
+
+/**
+ * @brief a vertex of a polygon being clipped, in camera space, with its attributes
+ * 
+ */
+struct ClipVertex {
+	Vector3f position;
+	float values[VARYING_COUNT];
+};
+
+/**
+ * @brief signed distance of a point to a clip plane, scaled by the plane normal length
  * 
- * @return sf::VertexArray the vertex array to draw in line mode
+ * @param plane the plane a * x + b * y + c * z + d, positive inside
+ * @param point the point in camera space
+ * @return float the plane equation at the point
  */
-sf::VertexArray Scene::drawWireframe() const {
-	sf::VertexArray vertexArray(sf::Lines, this->triangles.size() * 6);
-	for (long unsigned int  i = 0; i < this->triangles.size(); i++) {
-		for (int j = 0; j < 6; j+= 2) {
-			vertexArray[i * 6 + j].position = this->getProjection(this->triangles[i].at(j % 3));
-			vertexArray[i * 6 + j].color = this->colors[i];
+float planeDistance(const float *plane, const Vector3f &point) {
+	return plane[0] * point.x + plane[1] * point.y + plane[2] * point.z + plane[3];
+}
 
-			vertexArray[i * 6 + j + 1].position = this->getProjection(this->triangles[i].at((j + 1) % 3));
-			vertexArray[i * 6 + j + 1].color = this->colors[i];
+/**
+ * @brief clip a convex polygon against a plane (Sutherland-Hodgman)
+ * 
+ * @param polygon the vertices of the polygon
+ * @param count the number of vertices
+ * @param plane the plane, the part with a positive distance is kept
+ * @param interpolate true if the attributes of the new vertices are needed
+ * @param clipped filled with the vertices of the clipped polygon, it holds count + 1 vertices at most
+ * @return int the number of vertices of the clipped polygon
+ */
+int clipPolygon(const ClipVertex *polygon, int count, const float *plane, bool interpolate, ClipVertex *clipped) {
+	int clippedCount = 0;
+	for (int i = 0; i < count; i++) {
+		const ClipVertex &from = polygon[i];
+		const ClipVertex &to = polygon[(i + 1) % count];
+		float fromDistance = planeDistance(plane, from.position);
+		float toDistance = planeDistance(plane, to.position);
+		if (fromDistance >= 0) {
+			clipped[clippedCount++] = from;
+		}
+		if ((fromDistance >= 0) != (toDistance >= 0)) {
+			float t = fromDistance / (fromDistance - toDistance);
+			ClipVertex &vertex = clipped[clippedCount++];
+			vertex.position = from.position + (to.position - from.position) * t;
+			for (int k = 0; interpolate && k < VARYING_COUNT; k++) {
+				vertex.values[k] = from.values[k] + t * (to.values[k] - from.values[k]);
+			}
 		}
 	}
-	return vertexArray;
+	return clippedCount;
+}
+
 }
 
 /**
- * @brief draw normals of each triangles
+ * @brief compute the camera space planes of the view frustum and of the guard band
  * 
- * @return sf::VertexArray the vertex array that contains the normals in line mode
+ * the side planes are rows of the projection matrix combined in homogeneous
+ * coordinates, x / w >= limit becomes x - limit * w >= 0 with the sign of w
+ * in front of the camera
  */
-sf::VertexArray Scene::drawNormals() const {
-	sf::VertexArray vertexArray(sf::Lines, this->triangles.size() * 2);
-	for (long unsigned int i = 0; i < this->triangles.size(); i++) {		
-		Vector3f center = this->triangles[i].getCenter();
-		Vector3f normal = this->triangles[i].getNormal();
-
-		vertexArray[i * 2].position = this->getProjection(center);
-		vertexArray[i * 2].color = sf::Color::Red;
+void Scene::computeClipPlanes() {
+	const Matrix4 &m = this->projectionMatrix;
+	float sign = m.at(3, 2) * this->near + m.at(3, 3) < 0 ? -1 : 1;
+	float halfWidth = std::max(1u, this->width / 2);
+	float halfHeight = std::max(1u, this->height / 2);
+	// normalized device coordinates of the screen borders, getProjection() maps [-1, 1] to [0, 2 * half size]
+	float screen[4] = {-1, this->width / halfWidth - 1, -1, this->height / halfHeight - 1};
+	float guard[4] = {GUARD_BAND / halfWidth, GUARD_BAND / halfWidth, GUARD_BAND / halfHeight, GUARD_BAND / halfHeight};
 
-		vertexArray[i * 2 + 1].position = this->getProjection(center + normal * this->normalLength);
-		vertexArray[i * 2 + 1].color = sf::Color::Red;
+	float near[4] = {0, 0, 1, -this->near};
+	float far[4] = {0, 0, -1, this->far};
+	std::copy(near, near + 4, this->clipPlanes[CLIP_NEAR]);
+	std::copy(far, far + 4, this->clipPlanes[CLIP_FAR]);
+	for (int side = 0; side < 4; side++) {
+		// left and top keep the coordinate above the limit, right and bottom below it
+		int row = side / 2;
+		float direction = side % 2 == 0 ? 1 : -1;
+		for (int screenPlane = 0; screenPlane < 2; screenPlane++) {
+			float limit = screen[side] - (screenPlane ? 0 : direction * guard[side]);
+			float *plane = this->clipPlanes[(screenPlane ? CLIP_SCREEN_LEFT : CLIP_GUARD_LEFT) + side];
+			for (int j = 0; j < 4; j++) {
+				plane[j] = sign * direction * (m.at(row, j) - limit * m.at(3, j));
+			}
+		}
 	}
-	return vertexArray;
 }
 
 /**
- * @brief clear all buffers and triangles list
+ * @brief check if a shape is entirely outside the view frustum
+ * 
+ * the bounding sphere is tested first, then the 8 corners of the bounding box are
+ * moved to camera space: the shape is outside if all of them are outside one plane
  * 
+ * @param bounds the bounding volumes of the shape
+ * @param matrix the world matrix of the shape
+ * @return bool true if no triangle of the shape can be visible
  */
-void Scene::clear() {
-	this->triangles.clear();
-	this->colors.clear();
-	this->minZ = std::numeric_limits<float>::max();
-	this->maxZ = std::numeric_limits<float>::min();
-	for (long unsigned int i = 0; i < this->width * this->height * 4; i++) {
-		this->pixels[i] = 0;
+bool Scene::isOutsideFrustum(const ShapeBounds &bounds, const Matrix4 &matrix) const {
+	if (bounds.radius < 0) {
+		return false;
+	}
+	Matrix4 toCamera = this->cameraLookAtMatrix * matrix;
+
+	// the radius grows with the biggest scale of the matrix
+	float scale = 0;
+	for (int column = 0; column < 3; column++) {
+		Vector3f axis(toCamera.at(0, column), toCamera.at(1, column), toCamera.at(2, column));
+		scale = std::max(scale, axis.length());
+	}
+	Vector3f center = toCamera * bounds.center;
+	float radius = bounds.radius * scale;
+	for (int plane = 0; plane < CLIP_PLANES; plane++) {
+		const float *equation = this->clipPlanes[plane];
+		float normalLength = Vector3f(equation[0], equation[1], equation[2]).length();
+		if ((CLIP_REJECT_PLANES & (1 << plane)) && planeDistance(equation, center) < -radius * normalLength) {
+			return true;
+		}
 	}
-	for (long unsigned int i = 0; i < this->width * this->height; i++) {
-		this->zBuffer[i] = 0;
+
+	Vector3f corners[8];
+	for (int i = 0; i < 8; i++) {
+		corners[i] = Vector3f(
+			i & 1 ? bounds.max.x : bounds.min.x,
+			i & 2 ? bounds.max.y : bounds.min.y,
+			i & 4 ? bounds.max.z : bounds.min.z
+		);
 	}
+	return this->areOutsideFrustum(corners, toCamera);
 }
 
 /**
- * @brief draw the scene to the screen
+ * @brief check if a box in world space is entirely outside the view frustum
  * 
- * @param target the window to draw in
+ * @param box the bounding box of the triangles of a shape
+ * @return bool true if no triangle in the box can be visible
  */
-void Scene::draw(sf::RenderTarget& target) {
-	for (long unsigned int i = 0; i < this->triangles.size(); i++) {
-		setTrianglePosFromCamera(this->triangles[i]);
+bool Scene::isOutsideFrustum(const BoundingBox &box) const {
+	Vector3f corners[8];
+	for (int i = 0; i < 8; i++) {
+		corners[i] = Vector3f(
+			i & 1 ? box.max.x : box.min.x,
+			i & 2 ? box.max.y : box.min.y,
+			i & 4 ? box.max.z : box.min.z
+		);
 	}
-	clipAgainstPlane(Vector3f(0,0,1), -this->near);
-	clipAgainstPlane(Vector3f(0,0,-1), this->far);
+	return this->areOutsideFrustum(corners, this->cameraLookAtMatrix);
+}
 
-	if (this->zbuffer) {
-		this->drawFaces();
-		this->drawZBuffer();
-		target.draw(this->sprite);
-		return;
+/**
+ * @brief check if the 8 corners of a box are all outside the same reject plane
+ * 
+ * @param corners the 8 corners of the box, moved to camera space in place
+ * @param toCamera the matrix moving the corners to camera space
+ * @return bool true if the box is outside the view frustum
+ */
+bool Scene::areOutsideFrustum(Vector3f *corners, const Matrix4 &toCamera) const {
+	toCamera.transformPoints(corners, corners, 8, true);
+	unsigned outside = CLIP_REJECT_PLANES;
+	for (int i = 0; i < 8; i++) {
+		unsigned outcode = 0;
+		for (int plane = 0; plane < CLIP_PLANES; plane++) {
+			outcode |= (planeDistance(this->clipPlanes[plane], corners[i]) < 0) << plane;
+		}
+		outside &= outcode;
 	}
+	return outside != 0;
+}
 
-	if (this->faces) {
-		this->drawFaces();
-		target.draw(this->sprite);
+/**
+ * @brief find the triangles of a mesh drawn with the current world matrix that may be in the view frustum
+ * 
+ * the reject planes are moved to the space of the mesh and its hierarchy is
+ * walked from the root: nodes outside one plane are skipped with all their
+ * triangles, nodes inside all of them are kept without testing their children,
+ * the skipped triangles are the ones the clipper would have rejected
+ * 
+ * @param mesh the mesh about to be submitted
+ * @return bool true if visibleTriangles tells which triangles to submit, false if they all are
+ */
+bool Scene::cullMesh(const Mesh &mesh) {
+	if (!this->culling || mesh.bvh.empty()) {
+		return false;
 	}
-
-	if (this->wireframe) {
-		target.draw(this->drawWireframe());
+	Matrix4 toCamera = this->cameraLookAtMatrix * this->worldStateMatrix;
+	float planes[CLIP_PLANES][4];
+	unsigned count = 0;
+	for (int plane = 0; plane < CLIP_PLANES; plane++) {
+		if (!(CLIP_REJECT_PLANES & (1 << plane))) {
+			continue;
+		}
+		for (int j = 0; j < 4; j++) {
+			planes[count][j] = 0;
+			for (int i = 0; i < 4; i++) {
+				planes[count][j] += this->clipPlanes[plane][i] * toCamera.at(i, j);
+			}
+		}
+		count++;
 	}
 
-	if (this->normals) {
-		target.draw(this->drawNormals());
+	auto test = [&planes, count](const BvhNode &node) {
+		BvhOverlap overlap = BVH_INSIDE;
+		for (unsigned plane = 0; plane < count; plane++) {
+			const float *equation = planes[plane];
+			// distances of the box corners farthest along and against the plane normal
+			float farthest = equation[3], nearest = equation[3];
+			for (int axis = 0; axis < 3; axis++) {
+				float low = equation[axis] * node.min[axis];
+				float high = equation[axis] * node.max[axis];
+				farthest += std::max(low, high);
+				nearest += std::min(low, high);
+			}
+			if (farthest < 0) {
+				return BVH_OUTSIDE;
+			}
+			if (nearest < 0) {
+				overlap = BVH_CROSSING;
+			}
+		}
+		return overlap;
+	};
+	if (test(mesh.bvh.getNodes()[0]) == BVH_INSIDE) {
+		return false;
 	}
+
+	this->visibleTriangles.assign(mesh.triangleCount(), 0);
+	char *visible = this->visibleTriangles.data();
+	mesh.bvh.query(test, [visible](uint32_t triangle) {
+		visible[triangle] = 1;
+	});
+	return true;
 }
 
 /**
- * @brief return the minimum ad maximum z-buffer values
+ * @brief clip the submitted triangles to the view frustum in a single pass
  * 
- * @return std::tuple<float, float> min and max z-buffer values
+ * each vertex gets an outcode with a bit per plane it is outside of: triangles
+ * outside one plane of the screen frustum are rejected, triangles inside the near,
+ * far and guard band planes are kept as they are, the others are clipped as
+ * polygons against the planes they cross only, the guard band is wide enough for
+ * most triangles crossing the screen borders to be rasterized without side clipping
+ * 
+ * back facing triangles are removed, the other lists of the frame are kept in sync
+ * 
+ * the outcodes are computed first by a branchless loop over the padded position
+ * arrays, which the compiler turns into packed SIMD code, then a scalar loop keeps,
+ * clips or drops each triangle
  */
-std::tuple<float, float> Scene::getZbound() const {
-	return std::make_tuple(this->minZ, this->maxZ);
-}
\ No newline at end of file
+void Scene::clipTriangles() {
+	FrameGeometry &geometry = this->geometry;
+	// reused each frame so the lists keep their capacity
+	FrameGeometry &clipped = this->clippedGeometry;
+	clipped.triangles.clear();
+	clipped.colors.clear();
+	clipped.varyings.clear();
+	clipped.sources.clear();
+
+	const unsigned rejectPlanes = CLIP_REJECT_PLANES;
+	const unsigned clipPlanes = (1 << CLIP_NEAR) | (1 << CLIP_FAR) | (0xf << CLIP_GUARD_LEFT);
+	const TriangleStream &stream = geometry.triangles;
+	unsigned padded = stream.paddedSize();
+	this->outsideCodes.resize(padded);
+	this->crossedCodes.resize(padded);
+	uint32_t *__restrict outsideCodes = this->outsideCodes.data();
+	uint32_t *__restrict crossedCodes = this->crossedCodes.data();
+	float planes[CLIP_PLANES][4];
+	std::copy(&this->clipPlanes[0][0], &this->clipPlanes[0][0] + CLIP_PLANES * 4, &planes[0][0]);
+
+	for (unsigned i = 0; i < padded; i++) {
+		float x[3], y[3], z[3];
+		for (int v = 0; v < 3; v++) {
+			x[v] = stream.x[v][i];
+			y[v] = stream.y[v][i];
+			z[v] = stream.z[v][i];
+		}
+
+		// a triangle faces the camera, at the origin, when its normal and its first vertex point in opposite directions
+		float ux = x[1] - x[0], uy = y[1] - y[0], uz = z[1] - z[0];
+		float vx = x[2] - x[0], vy = y[2] - y[0], vz = z[2] - z[0];
+		float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+		bool visible = nx * x[0] + ny * y[0] + nz * z[0] < 0;
+
+		// fully unrolled, the loop over the triangles is left without branches to vectorize
+		uint32_t outside = ~0u, crossed = 0;
+		#pragma GCC unroll 3
+		for (int v = 0; v < 3; v++) {
+			uint32_t outcode = 0;
+			#pragma GCC unroll 10
+			for (int plane = 0; plane < CLIP_PLANES; plane++) {
+				float distance = planes[plane][0] * x[v] + planes[plane][1] * y[v] + planes[plane][2] * z[v] + planes[plane][3];
+				outcode |= (uint32_t)(distance < 0) << plane;
+			}
+			outside &= outcode;
+			crossed |= outcode;
+		}
+		// back facing triangles are outside of every plane so they are rejected with the others
+		outsideCodes[i] = visible ? outside : ~0u;
+		crossedCodes[i] = crossed;
+	}
+
+	for (unsigned i = 0; i < stream.size(); i++) {
+		if (outsideCodes[i] & rejectPlanes) {
+			continue;
+		}
+		if (crossedCodes[i] & clipPlanes) {
+			this->clipTriangle(geometry, i, crossedCodes[i] & clipPlanes, clipped);
+			continue;
+		}
+		clipped.triangles.push(stream, i);
+		clipped.colors.push_back(geometry.colors[i]);
+		if (!geometry.varyings.empty()) {
+			clipped.varyings.push_back(geometry.varyings[i]);
+		}
+		if (!geometry.sources.empty()) {
+			clipped.sources.push_back(geometry.sources[i]);
+		}
+	}
+
+	geometry.triangles.swap(clipped.triangles);
+	geometry.colors.swap(clipped.colors);
+	geometry.varyings.swap(clipped.varyings);
+	geometry.sources.swap(clipped.sources);
+}
+
+/**
+ * @brief clip a triangle against some planes and add the resulting fan of triangles
+ * 
+ * the colors, the varyings and the sources of the clipped triangles are copied
+ * from the triangle, the varyings of the new vertices are interpolated
+ * 
+ * @param geometry the triangles to clip
+ * @param index the index of the triangle to clip
+ * @param planes a bit per clip plane to clip against
+ * @param clipped the geometry the parts of the triangle inside the planes are added to
+ */
+void Scene::clipTriangle(const FrameGeometry &geometry, unsigned index, unsigned planes, FrameGeometry &clipped) const {
+	const TriangleVaryings *varyings = geometry.varyings.empty() ? nullptr : &geometry.varyings[index];
+
+	// a triangle clipped by n planes has at most 3 + n vertices
+	ClipVertex polygons[2][3 + CLIP_PLANES];
+	int count = 3;
+	for (int v = 0; v < 3; v++) {
+		polygons[0][v].position = geometry.triangles.vertex(index, v);
+		for (int k = 0; varyings && k < VARYING_COUNT; k++) {
+			polygons[0][v].values[k] = varyings->values[v][k];
+		}
+	}
+	int current = 0;
+	for (int plane = 0; plane < CLIP_PLANES && count >= 3; plane++) {
+		if (planes & (1 << plane)) {
+			count = clipPolygon(polygons[current], count, this->clipPlanes[plane], varyings != nullptr, polygons[1 - current]);
+			current = 1 - current;
+		}
+	}
+
+	const ClipVertex *polygon = polygons[current];
+	for (int v = 1; v + 1 < count; v++) {
+		clipped.triangles.push(polygon[0].position, polygon[v].position, polygon[v + 1].position);
+		clipped.colors.push_back(geometry.colors[index]);
+		if (varyings) {
+			TriangleVaryings result;
+			result.texture = varyings->texture;
+			const ClipVertex *vertices[3] = {&polygon[0], &polygon[v], &polygon[v + 1]};
+			for (int i = 0; i < 3; i++) {
+				std::copy(vertices[i]->values, vertices[i]->values + VARYING_COUNT, result.values[i]);
+			}
+			clipped.varyings.push_back(result);
+		}
+		if (!geometry.sources.empty()) {
+			clipped.sources.push_back(geometry.sources[index]);
+		}
+	}
+}
+
+/**
+ * @brief calculate one of tree baricentric coordinates of a point in a triangle, scaled by the triangle area
+ * 
+ * points are in fixed point so the result is exact
+ * 
+ * @param p1 one point of the triangle
+ * @param p2 point after p1 in clockwise order
+ * @param p3 point to check
+ * @return int64_t the barycentric component of p1
+ */
+int64_t Scene::edgeFunction(const Vector2l &p1, const Vector2l &p2, const Vector2l &p3) const {
+	return ((p3.x - p1.x) * (p2.y - p1.y) - (p3.y - p1.y) * (p2.x - p1.x));
+}
+
+/**
+ * @brief project a 3d vector and snap it to the subpixel grid
+ * 
+ * @param vector the vector to project
+ * @param snapped the projected vector in 1/SUBPIXEL_SCALE pixels
+ * @return bool false if the projection is too far from the screen to be represented
+ */
+bool Scene::getFixedProjection(const Vector3f &vector, Vector2l &snapped) const {
+	// keep edge function products far from 64 bit overflow
+	const float limit = 1 << 25;
+	Vector2f projected = this->getProjection(vector);
+	if (!(std::abs(projected.x) < limit && std::abs(projected.y) < limit)) {
+		return false;
+	}
+	snapped.x = std::floor(projected.x * SUBPIXEL_SCALE + 0.5f);
+	snapped.y = std::floor(projected.y * SUBPIXEL_SCALE + 0.5f);
+	return true;
+}
+
+/**
+ * @brief compute the screen space constants of a triangle: edge functions, depth plane and bounding box
+ * 
+ * @param vertices the 3 vertices of the triangle to setup, in camera space
+ * @param varyings the vertex attributes to interpolate, nullptr for a flat triangle
+ * @param setup the structure to fill
+ * @return bool false if the triangle covers no pixel and can be skipped
+ */
+bool Scene::setupTriangle(const Vector3f *vertices, const TriangleVaryings *varyings, TriangleSetup &setup) const {
+	setup.size = TRIANGLE_CULLED;
+	Vector2l p[3];
+	if (
+		!this->getFixedProjection(vertices[0], p[0]) ||
+		!this->getFixedProjection(vertices[1], p[1]) ||
+		!this->getFixedProjection(vertices[2], p[2])
+	) {
+		return false;
+	}
+
+	int64_t area = edgeFunction(p[0], p[1], p[2]);
+	if (area <= 0) { // back facing or degenerated
+		return false;
+	}
+
+	// pixels whose center is inside the bounding box
+	const int64_t half = SUBPIXEL_SCALE / 2;
+	int64_t minX = (std::min(p[0].x, std::min(p[1].x, p[2].x)) - half + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS;
+	int64_t maxX = (std::max(p[0].x, std::max(p[1].x, p[2].x)) - half) >> SUBPIXEL_BITS;
+	int64_t minY = (std::min(p[0].y, std::min(p[1].y, p[2].y)) - half + SUBPIXEL_SCALE - 1) >> SUBPIXEL_BITS;
+	int64_t maxY = (std::max(p[0].y, std::max(p[1].y, p[2].y)) - half) >> SUBPIXEL_BITS;
+	setup.minX = std::max<int64_t>(0, minX);
+	setup.maxX = std::min<int64_t>(this->width - 1, maxX);
+	setup.minY = std::max<int64_t>(0, minY);
+	setup.maxY = std::min<int64_t>(this->height - 1, maxY);
+	if (setup.minX > setup.maxX || setup.minY > setup.maxY) {
+		return false;
+	}
+
+	// edge planes without the fill rule bias, the attribute planes are built from them
+	int64_t planeC[3];
+	setup.narrowSteps = true;
+	for (int i = 0; i < 3; i++) {
+		// edgeFunction(pa, pb, (x, y)) expanded as a * x + b * y + c, then evaluated at pixel centers
+		const Vector2l &pa = p[(i + 1) % 3];
+		const Vector2l &pb = p[(i + 2) % 3];
+		int64_t a = pb.y - pa.y;
+		int64_t b = pa.x - pb.x;
+		int64_t c = pa.y * (pb.x - pa.x) - pa.x * (pb.y - pa.y);
+		setup.edgeA[i] = a * SUBPIXEL_SCALE;
+		setup.edgeB[i] = b * SUBPIXEL_SCALE;
+		planeC[i] = c + (a + b) * half;
+
+		// top-left rule: pixels exactly on an edge belong to the triangle only if it is a top or a left edge
+		bool topLeft = a > 0 || (a == 0 && b > 0);
+		setup.edgeC[i] = topLeft ? planeC[i] : planeC[i] - 1;
+
+		setup.narrowSteps &= std::abs(setup.edgeA[i]) <= ((int64_t)1 << 30) / RASTERIZER_SEGMENT;
+	}
+
+	// small triangles are point sampled here first, most of the ones covering no pixel center stop before their planes are built
+	int boxWidth = setup.maxX - setup.minX + 1;
+	if (boxWidth * (setup.maxY - setup.minY + 1) <= SMALL_TRIANGLE_AREA) {
+		bool covered = false;
+		for (int y = setup.minY; y <= setup.maxY && !covered; y++) {
+			for (int x = setup.minX; x <= setup.maxX && !covered; x++) {
+				covered = true;
+				for (int i = 0; i < 3; i++) {
+					covered &= setup.edgeA[i] * x + setup.edgeB[i] * y + setup.edgeC[i] >= 0;
+				}
+			}
+		}
+		if (!covered) {
+			setup.size = TRIANGLE_EMPTY;
+			return false;
+		}
+		setup.size = TRIANGLE_SMALL;
+	} else {
+		setup.size = boxWidth >= LARGE_TRIANGLE_WIDTH ? TRIANGLE_LARGE : TRIANGLE_MEDIUM;
+	}
+
+	// 1/z is affine in screen space, interpolate it with the normalized barycentric coordinates
+	double invArea = 1.0 / area;
+	double depth[3] = {1.0 / vertices[0].z, 1.0 / vertices[1].z, 1.0 / vertices[2].z};
+	double depthA = 0, depthB = 0, depthC = 0;
+	// the attributes divided by z are affine too, the kernels multiply them back by z
+	double varyingA[VARYING_COUNT] = {}, varyingB[VARYING_COUNT] = {}, varyingC[VARYING_COUNT] = {};
+	setup.smooth = varyings != nullptr;
+	setup.texture = varyings ? varyings->texture : nullptr;
+
+	for (int i = 0; i < 3; i++) {
+		depthA += setup.edgeA[i] * invArea * depth[i];
+		depthB += setup.edgeB[i] * invArea * depth[i];
+		depthC += planeC[i] * invArea * depth[i];
+		for (int k = 0; setup.smooth && k < VARYING_COUNT; k++) {
+			double value = depth[i] * varyings->values[i][k];
+			varyingA[k] += setup.edgeA[i] * invArea * value;
+			varyingB[k] += setup.edgeB[i] * invArea * value;
+			varyingC[k] += planeC[i] * invArea * value;
+		}
+	}
+
+	setup.depthA = depthA;
+	setup.depthB = depthB;
+	setup.depthC = depthC;
+	for (int k = 0; k < VARYING_COUNT; k++) {
+		setup.varyingA[k] = varyingA[k];
+		setup.varyingB[k] = varyingB[k];
+		setup.varyingC[k] = varyingC[k];
+	}
+	setup.minDepth = std::min(depth[0], std::min(depth[1], depth[2]));
+	setup.maxDepth = std::max(depth[0], std::max(depth[1], depth[2]));
+
+	return true;
+}
+
+/**
+ * @brief draw a triangle to the screen
+ * 
+ * the pending frame is finished first and the triangle is drawn in the framebuffer
+ * returned by getFramebuffer(), in pipelined mode the last finished frame
+ * 
+ * @param t the triangle to draw
+ * @param color the triangle color
+ */
+void Scene::rasterizeTriangle(const Triangle &t, const Color& color) {
+	this->finish();
+	if (this->pipelined) {
+		this->resizePresentedFramebuffer();
+	}
+	Framebuffer &target = this->pipelined ? this->presentedFramebuffer : this->framebuffer;
+	if (this->geometry.cleared) {
+		this->clearFramebuffer(target);
+		this->geometry.cleared = false;
+		this->depthTests.clear();
+	}
+	if (this->overdraw && this->depthTests.size() != (size_t)target.getStride() * this->height) {
+		this->resetOverdraw();
+	}
+
+	TriangleSetup setup;
+	Vector3f vertices[3] = {t.v1, t.v2, t.v3};
+	if (!this->setupTriangle(vertices, nullptr, setup)) {
+		return;
+	}
+
+	this->minZ = std::min(this->minZ, setup.minDepth);
+	this->maxZ = std::max(this->maxZ, setup.maxDepth);
+
+	for (int y = setup.minY / TILE_SIZE; y <= setup.maxY / TILE_SIZE; y++) {
+		for (int x = setup.minX / TILE_SIZE; x <= setup.maxX / TILE_SIZE; x++) {
+			target.resolveTile(x, y);
+		}
+	}
+	this->drawSetup(setup, color, target);
+}
+
+/**
+ * @brief fill a set up triangle with the selected pixel kernel
+ * 
+ * @param setup the triangle to draw, its bounding box must be inside the render area
+ * @param color the triangle color
+ * @param target the framebuffer to draw in
+ * @return unsigned the number of pixels written
+ */
+unsigned Scene::drawSetup(const TriangleSetup &setup, const Color &color, Framebuffer &target) {
+	uint8_t *pixels = target.getColorBuffer();
+	float *zBuffer = target.getDepthBuffer();
+	unsigned stride = target.getStride();
+	// the few pixels of a small triangle do not fill the simd lanes
+	bool simd = this->simd && setup.size != TRIANGLE_SMALL;
+	if (this->overdraw) {
+		return Rasterizer::drawCounted(setup, color, pixels, zBuffer, this->depthTests.data(), this->pixelWrites.data(), stride);
+	}
+	if (setup.texture) {
+		if (simd) {
+			return Rasterizer::drawTexturedSIMD(setup, pixels, zBuffer, stride);
+		}
+		return Rasterizer::drawTexturedScalar(setup, pixels, zBuffer, stride);
+	}
+	if (setup.smooth) {
+		if (simd) {
+			return Rasterizer::drawSmoothSIMD(setup, pixels, zBuffer, stride);
+		}
+		return Rasterizer::drawSmoothScalar(setup, pixels, zBuffer, stride);
+	}
+	if (simd) {
+		return Rasterizer::drawSIMD(setup, color, pixels, zBuffer, stride);
+	}
+	return Rasterizer::drawScalar(setup, color, pixels, zBuffer, stride);
+}
+
+/**
+ * @brief draw a triangle of the rasterized frame, in visibility mode only its id is written
+ * 
+ * @param setup the triangle to draw, its bounding box must be inside the render area
+ * @param index the index of the triangle in the rasterized frame, used as its id
+ * @return unsigned the number of pixels written
+ */
+unsigned Scene::drawTriangle(const TriangleSetup &setup, unsigned index) {
+	if (!this->visibility) {
+		return this->drawSetup(setup, this->rasterGeometry.colors[index], this->framebuffer);
+	}
+	uint32_t *ids = this->framebuffer.getIdBuffer();
+	float *zBuffer = this->framebuffer.getDepthBuffer();
+	unsigned stride = this->framebuffer.getStride();
+	bool simd = this->simd && setup.size != TRIANGLE_SMALL;
+	if (this->overdraw) {
+		return Rasterizer::drawIdCounted(setup, index, ids, zBuffer, this->depthTests.data(), stride);
+	}
+	if (simd) {
+		return Rasterizer::drawIdSIMD(setup, index, ids, zBuffer, stride);
+	}
+	return Rasterizer::drawIdScalar(setup, index, ids, zBuffer, stride);
+}
+
+/**
+ * @brief put each rasterizable triangle in the bins of the tiles its bounding box overlaps
+ * 
+ */
+void Scene::binTriangles() {
+	FrameGeometry &geometry = this->geometry;
+	geometry.tiles.resize(this->tilesX * this->tilesY);
+	for (std::vector<unsigned> &tile : geometry.tiles) {
+		tile.clear();
+	}
+
+	for (unsigned i = 0; i < geometry.setups.size(); i++) {
+		if (!geometry.rasterizable[i]) {
+			continue;
+		}
+		const TriangleSetup &setup = geometry.setups[i];
+		this->minZ = std::min(this->minZ, setup.minDepth);
+		this->maxZ = std::max(this->maxZ, setup.maxDepth);
+
+		for (int y = setup.minY / TILE_SIZE; y <= setup.maxY / TILE_SIZE; y++) {
+			for (int x = setup.minX / TILE_SIZE; x <= setup.maxX / TILE_SIZE; x++) {
+				geometry.tiles[y * this->tilesX + x].push_back(i);
+			}
+		}
+	}
+}
+
+/**
+ * @brief recompute the farthest depth of a z-buffer block
+ * 
+ * @param blockX the block column
+ * @param blockY the block line
+ */
+void Scene::updateBlockDepth(unsigned blockX, unsigned blockY) {
+	int minX = blockX * HIZ_BLOCK_SIZE;
+	int minY = blockY * HIZ_BLOCK_SIZE;
+	int maxX = std::min(minX + HIZ_BLOCK_SIZE, (int)this->width) - 1;
+	int maxY = std::min(minY + HIZ_BLOCK_SIZE, (int)this->height) - 1;
+	this->blockDepth[blockY * this->blocksX + blockX] = Rasterizer::farthestDepth(
+		this->framebuffer.getDepthBuffer(), this->framebuffer.getStride(), minX, maxX, minY, maxY);
+}
+
+/**
+ * @brief recompute the farthest depth of the written blocks of a tile, then of the tile
+ * 
+ * @param tile the tile index
+ * @param dirtyBlocks one bit per block of the tile, row by row, set if the block was written
+ */
+void Scene::updateTileDepth(unsigned tile, uint64_t dirtyBlocks) {
+	const unsigned tileBlocks = TILE_SIZE / HIZ_BLOCK_SIZE;
+	unsigned firstBlockX = (tile % this->tilesX) * tileBlocks;
+	unsigned firstBlockY = (tile / this->tilesX) * tileBlocks;
+	unsigned lastBlockX = std::min(this->blocksX, firstBlockX + tileBlocks);
+	unsigned lastBlockY = std::min(this->blocksY, firstBlockY + tileBlocks);
+
+	// the tile depth is the farthest of its blocks depth
+	float depth = std::numeric_limits<float>::max();
+	for (unsigned y = firstBlockY; y < lastBlockY; y++) {
+		for (unsigned x = firstBlockX; x < lastBlockX; x++) {
+			if ((dirtyBlocks >> ((y - firstBlockY) * tileBlocks + x - firstBlockX)) & 1) {
+				this->updateBlockDepth(x, y);
+			}
+			depth = std::min(depth, this->blockDepth[y * this->blocksX + x]);
+		}
+	}
+	this->tileDepth[tile] = depth;
+}
+
+/**
+ * @brief rasterize a triangle skipping the z-buffer blocks where it is hidden
+ * 
+ * if no block is hidden the triangle is drawn with a single kernel call,
+ * else consecutive visible blocks of each block line are drawn together
+ * 
+ * the depth of the blocks is not updated here, the blocks the triangle may
+ * have written are marked so the tile updates them once per batch of triangles
+ * 
+ * @param setup the triangle clipped to one tile
+ * @param index the index of the triangle in the rasterized frame
+ * @param stats the tile counters to update
+ * @param dirtyBlocks the blocks of the tile to update, one bit per block row by row
+ */
+void Scene::rasterizeBlocks(TriangleSetup setup, unsigned index, RenderStats &stats, uint64_t &dirtyBlocks) {
+	const int tileBlocks = TILE_SIZE / HIZ_BLOCK_SIZE;
+	static_assert((TILE_SIZE / HIZ_BLOCK_SIZE) * (TILE_SIZE / HIZ_BLOCK_SIZE) <= 64, "the blocks of a tile must fit a 64 bit mask");
+	int minX = setup.minX, maxX = setup.maxX;
+	int minY = setup.minY, maxY = setup.maxY;
+	int firstBlockX = minX / HIZ_BLOCK_SIZE, lastBlockX = maxX / HIZ_BLOCK_SIZE;
+	int firstBlockY = minY / HIZ_BLOCK_SIZE, lastBlockY = maxY / HIZ_BLOCK_SIZE;
+	int tileBlockX = firstBlockX / tileBlocks * tileBlocks;
+	int tileBlockY = firstBlockY / tileBlocks * tileBlocks;
+
+	unsigned long rejected = 0;
+	uint64_t visibleBlocks = 0;
+	for (int blockY = firstBlockY; blockY <= lastBlockY; blockY++) {
+		const float *depth = &this->blockDepth[blockY * this->blocksX];
+		for (int blockX = firstBlockX; blockX <= lastBlockX; blockX++) {
+			bool hidden = setup.maxDepth < depth[blockX];
+			rejected += hidden;
+			visibleBlocks |= (uint64_t)!hidden << ((blockY - tileBlockY) * tileBlocks + blockX - tileBlockX);
+		}
+	}
+	unsigned long blocks = (lastBlockX - firstBlockX + 1) * (lastBlockY - firstBlockY + 1);
+	stats.blocks += blocks;
+	stats.rejectedBlocks += rejected;
+
+	if (rejected == blocks) {
+		return;
+	}
+
+	unsigned long written = 0;
+	if (rejected == 0) {
+		written = this->drawTriangle(setup, index);
+	} else {
+		for (int blockY = firstBlockY; blockY <= lastBlockY; blockY++) {
+			setup.minY = std::max(minY, blockY * HIZ_BLOCK_SIZE);
+			setup.maxY = std::min(maxY, blockY * HIZ_BLOCK_SIZE + HIZ_BLOCK_SIZE - 1);
+			const float *depth = &this->blockDepth[blockY * this->blocksX];
+
+			int blockX = firstBlockX;
+			while (blockX <= lastBlockX) {
+				if (setup.maxDepth < depth[blockX]) {
+					blockX++;
+					continue;
+				}
+
+				int runEnd = blockX;
+				while (runEnd < lastBlockX && setup.maxDepth >= depth[runEnd + 1]) {
+					runEnd++;
+				}
+
+				setup.minX = std::max(minX, blockX * HIZ_BLOCK_SIZE);
+				setup.maxX = std::min(maxX, runEnd * HIZ_BLOCK_SIZE + HIZ_BLOCK_SIZE - 1);
+				written += this->drawTriangle(setup, index);
+				blockX = runEnd + 1;
+			}
+		}
+	}
+
+	stats.passedPixels += written;
+	if (written > 0) {
+		dirtyBlocks |= visibleBlocks;
+	}
+}
+
+/**
+ * @brief rasterize the triangles of a tile, clipped to the tile bounds
+ * 
+ * tiles do not overlap so they can be rasterized in parallel without locks
+ * 
+ * @param tile the tile index
+ */
+void Scene::rasterizeTile(unsigned tile) {
+	int tileMinX = (tile % this->tilesX) * TILE_SIZE;
+	int tileMinY = (tile / this->tilesX) * TILE_SIZE;
+	int tileMaxX = tileMinX + TILE_SIZE - 1;
+	int tileMaxY = tileMinY + TILE_SIZE - 1;
+
+	const FrameGeometry &geometry = this->rasterGeometry;
+	RenderStats &stats = this->tileStats[tile];
+	stats = RenderStats();
+
+	// ids of a frame drawn over the previous one are cleared anyway, they would not match its triangles
+	if (this->visibility && !geometry.cleared) {
+		this->framebuffer.clearTileIds(tile % this->tilesX, tile / this->tilesX);
+	}
+
+	// a pending clear is done here, in parallel, right before the tile is drawn
+	if (!geometry.tiles[tile].empty()) {
+		this->framebuffer.resolveTile(tile % this->tilesX, tile / this->tilesX);
+	}
+
+	// blocks written since the tile depth was last updated and the triangles drawn since then
+	uint64_t dirtyBlocks = 0;
+	unsigned batched = 0;
+	for (unsigned index : geometry.tiles[tile]) {
+		TriangleSetup setup = geometry.setups[index];
+		setup.minX = std::max(setup.minX, tileMinX);
+		setup.maxX = std::min(setup.maxX, tileMaxX);
+		setup.minY = std::max(setup.minY, tileMinY);
+		setup.maxY = std::min(setup.maxY, tileMaxY);
+
+		stats.triangles++;
+		if (!this->hiz) {
+			stats.passedPixels += this->drawTriangle(setup, index);
+			continue;
+		}
+		
+		if (setup.maxDepth < this->tileDepth[tile]) {
+			stats.rejectedTriangles++;
+			continue;
+		}
+		this->rasterizeBlocks(setup, index, stats, dirtyBlocks);
+		if (dirtyBlocks && ++batched == HIZ_UPDATE_BATCH) {
+			this->updateTileDepth(tile, dirtyBlocks);
+			dirtyBlocks = 0;
+			batched = 0;
+		}
+	}
+	if (dirtyBlocks) {
+		this->updateTileDepth(tile, dirtyBlocks);
+	}
+
+	if (!this->visibility) {
+		stats.writtenPixels = stats.passedPixels;
+	}
+	if (this->overdraw) {
+		unsigned stride = this->framebuffer.getStride();
+		for (int y = tileMinY; y <= std::min<int>(tileMaxY, this->height - 1); y++) {
+			for (int x = tileMinX; x <= std::min<int>(tileMaxX, this->width - 1); x++) {
+				stats.testedPixels += this->depthTests[y * stride + x];
+			}
+		}
+	}
+}
+
+/**
+ * @brief shade the visible pixels of a tile from its id buffer, in visibility mode
+ * 
+ * each run of pixels holding the same id is shaded at once, then the ids are
+ * replaced by the submission index of the triangles for getTriangleAt()
+ * 
+ * @param tile the tile index
+ */
+void Scene::shadeTile(unsigned tile) {
+	const FrameGeometry &geometry = this->rasterGeometry;
+	RenderStats &stats = this->tileStats[tile];
+	if (geometry.tiles[tile].empty()) {
+		return;
+	}
+	// only the part of the tile the binned triangles overlap can hold ids
+	int tileMinX = (tile % this->tilesX) * TILE_SIZE;
+	int tileMinY = (tile / this->tilesX) * TILE_SIZE;
+	int tileMaxX = std::min<int>(tileMinX + TILE_SIZE, this->width);
+	int tileMaxY = std::min<int>(tileMinY + TILE_SIZE, this->height);
+	int minX = tileMaxX, maxX = tileMinX, minY = tileMaxY, maxY = tileMinY;
+	for (unsigned index : geometry.tiles[tile]) {
+		const TriangleSetup &setup = geometry.setups[index];
+		minX = std::min(minX, setup.minX);
+		maxX = std::max(maxX, setup.maxX + 1);
+		minY = std::min(minY, setup.minY);
+		maxY = std::max(maxY, setup.maxY + 1);
+	}
+	tileMinX = std::max(tileMinX, minX);
+	tileMaxX = std::min(tileMaxX, maxX);
+	tileMinY = std::max(tileMinY, minY);
+	tileMaxY = std::min(tileMaxY, maxY);
+
+	uint8_t *pixels = this->framebuffer.getColorBuffer();
+	const float *zBuffer = this->framebuffer.getDepthBuffer();
+	uint32_t *ids = this->framebuffer.getIdBuffer();
+	unsigned stride = this->framebuffer.getStride();
+	for (int y = tileMinY; y < tileMaxY; y++) {
+		uint32_t *row = &ids[y * stride];
+		int x = tileMinX;
+		while (x < tileMaxX) {
+			uint32_t id = row[x];
+			int end = x;
+			while (end + 1 < tileMaxX && row[end + 1] == id) {
+				end++;
+			}
+			if (id != NO_TRIANGLE) {
+				Rasterizer::shadeSpan(geometry.setups[id], geometry.colors[id], y, x, end, zBuffer, pixels, stride);
+				std::fill(&row[x], &row[end + 1], geometry.sources[id]);
+				stats.writtenPixels += end - x + 1;
+				if (this->overdraw) {
+					for (int i = x; i <= end; i++) {
+						this->pixelWrites[y * stride + i]++;
+					}
+				}
+			}
+			x = end + 1;
+		}
+	}
+}
+
+/**
+ * @brief move the submitted triangles to camera space, sort and clip them then set them up and bin them
+ * 
+ * triangles are set up in parallel, on the geometry pool in pipelined mode since the raster
+ * pool may be busy with the previous frame, then binned into screen tiles in submission
+ * order, or in depth order if it is sorted
+ */
+void Scene::processGeometry() {
+	FrameGeometry &geometry = this->geometry;
+	geometry.triangles.transform(this->cameraLookAtMatrix, 0);
+	geometry.sources.clear();
+	if (this->visibility) {
+		geometry.sources.resize(geometry.triangles.size());
+		std::iota(geometry.sources.begin(), geometry.sources.end(), 0);
+	}
+	if (this->order != DRAW_SUBMITTED) {
+		this->sortTriangles();
+	}
+	this->clipTriangles();
+
+	unsigned count = this->faces || this->zbuffer || this->overdraw ? geometry.triangles.size() : 0;
+	auto varyings = [&geometry](unsigned i) {
+		return geometry.varyings.empty() ? nullptr : &geometry.varyings[i];
+	};
+	geometry.setups.resize(count);
+	geometry.rasterizable.resize(count);
+	ThreadPool &setupPool = this->pipelined ? this->getGeometryPool() : *this->pool;
+	const unsigned batchSize = 256;
+	setupPool.run((count + batchSize - 1) / batchSize, [this, &geometry, &varyings, count, batchSize](unsigned batch) {
+		unsigned end = std::min((batch + 1) * batchSize, count);
+		for (unsigned i = batch * batchSize; i < end; i++) {
+			Vector3f vertices[3];
+			geometry.triangles.getTriangle(i, vertices);
+			geometry.rasterizable[i] = this->setupTriangle(vertices, varyings(i), geometry.setups[i]);
+		}
+	});
+
+	this->binTriangles();
+}
+
+/**
+ * @brief reorder the submitted triangles by their depth in camera space
+ * 
+ * each shape is split into clusters of up to SORT_CLUSTER_SIZE consecutive
+ * triangles, which are near each other in most meshes, the nearest or the
+ * farthest depth of each cluster is quantized to SORT_KEY_BITS in the depth range
+ * of the frame and the clusters are ordered by a stable radix sort on it, then
+ * the lists of the frame are gathered in the new order
+ */
+void Scene::sortTriangles() {
+	FrameGeometry &geometry = this->geometry;
+	const TriangleStream &stream = geometry.triangles;
+	unsigned count = stream.size();
+	if (count == 0) {
+		return;
+	}
+	bool frontToBack = this->order == DRAW_FRONT_TO_BACK;
+
+	std::vector<uint32_t> &starts = this->clusterStarts;
+	std::vector<float> &depths = this->clusterDepths;
+	starts.clear();
+	depths.clear();
+	float nearest = std::numeric_limits<float>::max(), farthest = -std::numeric_limits<float>::max();
+	for (unsigned shape = 0; shape <= geometry.shapeStarts.size(); shape++) {
+		unsigned first = shape == 0 ? 0 : geometry.shapeStarts[shape - 1];
+		unsigned end = shape == geometry.shapeStarts.size() ? count : geometry.shapeStarts[shape];
+		for (unsigned start = first; start < end; start += SORT_CLUSTER_SIZE) {
+			unsigned last = std::min(start + SORT_CLUSTER_SIZE, end);
+			float low = std::numeric_limits<float>::max(), high = -std::numeric_limits<float>::max();
+			for (unsigned corner = 0; corner < 3; corner++) {
+				const float *z = stream.z[corner].data();
+				for (unsigned i = start; i < last; i++) {
+					low = std::min(low, z[i]);
+					high = std::max(high, z[i]);
+				}
+			}
+			starts.push_back(start);
+			depths.push_back(frontToBack ? low : high);
+			nearest = std::min(nearest, depths.back());
+			farthest = std::max(farthest, depths.back());
+		}
+	}
+	starts.push_back(count);
+
+	// the parts behind the near plane are clipped, their clusters are keyed as if they were on it
+	nearest = std::max(nearest, this->near);
+	const uint64_t maxKey = (1 << SORT_KEY_BITS) - 1;
+	float scale = farthest > nearest ? maxKey / (farthest - nearest) : 0;
+	std::vector<uint64_t> &keys = this->sortKeys;
+	keys.resize(depths.size());
+	for (unsigned i = 0; i < depths.size(); i++) {
+		uint64_t key = std::clamp((depths[i] - nearest) * scale, 0.0f, (float)maxKey);
+		keys[i] = (frontToBack ? key : maxKey - key) << 32 | i;
+	}
+	radixSort(keys, this->sortScratch, 32, SORT_KEY_BITS);
+
+	std::vector<uint32_t> &sorted = this->sortedTriangles;
+	sorted.resize(count);
+	unsigned next = 0;
+	for (uint64_t key : keys) {
+		uint32_t cluster = key & 0xffffffff;
+		for (uint32_t i = starts[cluster]; i < starts[cluster + 1]; i++) {
+			sorted[next++] = i;
+		}
+	}
+
+	// the clipper lists are free until it runs
+	FrameGeometry &gathered = this->clippedGeometry;
+	gathered.triangles.clear();
+	gathered.triangles.append(stream, sorted.data(), count);
+	geometry.triangles.swap(gathered.triangles);
+	gathered.colors.resize(count);
+	for (unsigned i = 0; i < count; i++) {
+		gathered.colors[i] = geometry.colors[sorted[i]];
+	}
+	geometry.colors.swap(gathered.colors);
+	if (!geometry.varyings.empty()) {
+		gathered.varyings.resize(count);
+		for (unsigned i = 0; i < count; i++) {
+			gathered.varyings[i] = geometry.varyings[sorted[i]];
+		}
+		geometry.varyings.swap(gathered.varyings);
+	}
+	if (!geometry.sources.empty()) {
+		gathered.sources.resize(count);
+		for (unsigned i = 0; i < count; i++) {
+			gathered.sources[i] = geometry.sources[sorted[i]];
+		}
+		geometry.sources.swap(gathered.sources);
+	}
+}
+
+/**
+ * @brief draw each binned triangle of the rasterized frame
+ * 
+ * tiles are rasterized in parallel, the result does not depend on the thread count
+ */
+void Scene::drawFaces() {
+	this->pool->run(this->rasterGeometry.tiles.size(), [this](unsigned tile) {
+		this->rasterizeTile(tile);
+	});
+}
+
+/**
+ * @brief clear a framebuffer and the hierarchical z-buffer
+ * 
+ * @param target the framebuffer to clear
+ */
+void Scene::clearFramebuffer(Framebuffer &target) {
+	target.clear();
+	std::fill(this->blockDepth.begin(), this->blockDepth.end(), 0);
+	std::fill(this->tileDepth.begin(), this->tileDepth.end(), 0);
+}
+
+/**
+ * @brief draw the rasterized frame and its overlays in the framebuffer
+ * 
+ */
+void Scene::rasterize() {
+	this->framebuffer.setIdBuffer(this->visibility);
+	if (this->rasterGeometry.cleared) {
+		this->clearFramebuffer(this->framebuffer);
+	} else if (this->pipelined) {
+		// the target still holds the frame before the presented one, the hierarchical
+		// z-buffer was built for the presented one and matches the copy
+		this->framebuffer.copy(this->presentedFramebuffer);
+	}
+	if (this->overdraw) {
+		this->resetOverdraw();
+	}
+
+	this->drawFaces();
+	if (this->visibility && !this->rasterGeometry.setups.empty()) {
+		this->pool->run(this->tilesX * this->tilesY, [this](unsigned tile) {
+			this->shadeTile(tile);
+		});
+	}
+	this->framebuffer.resolve();
+
+	if (this->zbuffer) {
+		this->drawZBuffer();
+		return;
+	}
+
+	if (this->overdraw) {
+		this->drawOverdraw();
+		return;
+	}
+
+	if (this->wireframe) {
+		this->drawWireframe();
+	}
+
+	if (this->normals) {
+		this->drawNormals();
+	}
+}
+
+/**
+ * @brief sum the counters of each tile into the frame statistics and count the size classes of the triangles
+ * 
+ */
+void Scene::collectStats() {
+	this->stats = RenderStats();
+	for (const RenderStats &tileStats : this->tileStats) {
+		this->stats += tileStats;
+	}
+	for (const TriangleSetup &setup : this->rasterGeometry.setups) {
+		this->stats.sizes[setup.size]++;
+	}
+	this->stats.shapes = this->rasterGeometry.shapes;
+	this->stats.culledShapes = this->rasterGeometry.culledShapes;
+}
+
+/**
+ * @brief replace the color buffer by the z-buffer in grayscale
+ * 
+ */
+void Scene::drawZBuffer() {
+	for (unsigned y = 0; y < this->height; y++) {
+		for (unsigned x = 0; x < this->width; x++) {
+			uint8_t zValue = this->framebuffer.getDepth(x, y) * 255;
+			this->framebuffer.setPixel(x, y, Color(zValue, zValue, zValue));
+		}
+	}
+}
+
+/**
+ * @brief size the overdraw counters to the framebuffer and set them to zero
+ * 
+ */
+void Scene::resetOverdraw() {
+	size_t size = (size_t)this->framebuffer.getStride() * this->height;
+	this->depthTests.assign(size, 0);
+	this->pixelWrites.assign(size, 0);
+}
+
+/**
+ * @brief replace the color buffer by a heatmap of the depth tests of each pixel
+ * 
+ * untested pixels are black, then each test moves the color along blue, cyan, green,
+ * yellow, orange, red and magenta, pixels tested OVERDRAW_MAX times or more are white
+ */
+void Scene::drawOverdraw() {
+	const Color ramp[OVERDRAW_MAX + 1] = {
+		Color::Black, Color::Blue, Color::Cyan, Color::Green, Color::Yellow,
+		Color(255, 128, 0), Color::Red, Color::Magenta, Color::White
+	};
+	unsigned stride = this->framebuffer.getStride();
+	for (unsigned y = 0; y < this->height; y++) {
+		for (unsigned x = 0; x < this->width; x++) {
+			unsigned tests = this->depthTests[y * stride + x];
+			this->framebuffer.setPixel(x, y, ramp[std::min<unsigned>(tests, OVERDRAW_MAX)]);
+		}
+	}
+}
+
+/**
+ * @brief draw the edges of each triangle over the color buffer
+ * 
+ */
+void Scene::drawWireframe() {
+	const FrameGeometry &geometry = this->rasterGeometry;
+	for (long unsigned int i = 0; i < geometry.triangles.size(); i++) {
+		for (int j = 0; j < 3; j++) {
+			this->framebuffer.drawLine(
+				this->getProjection(geometry.triangles.vertex(i, j)),
+				this->getProjection(geometry.triangles.vertex(i, (j + 1) % 3)),
+				geometry.colors[i]
+			);
+		}
+	}
+}
+
+/**
+ * @brief draw the normal of each triangle over the color buffer
+ * 
+ */
+void Scene::drawNormals() {
+	const FrameGeometry &geometry = this->rasterGeometry;
+	for (long unsigned int i = 0; i < geometry.triangles.size(); i++) {
+		Vector3f vertices[3];
+		geometry.triangles.getTriangle(i, vertices);
+		Vector3f center = (vertices[0] + vertices[1] + vertices[2]) / 3.0f;
+		Vector3f normal = (vertices[1] - vertices[0]).cross(vertices[2] - vertices[0]);
+		normal.normalize();
+
+		this->framebuffer.drawLine(
+			this->getProjection(center),
+			this->getProjection(center + normal * this->normalLength),
+			Color::Red
+		);
+	}
+}
+
+/**
+ * @brief clear all buffers and triangles list
+ * 
+ * the framebuffer clear is deferred to the rasterization of the next frame,
+ * each tile is cleared when it is first drawn in or at the end of the frame
+ */
+void Scene::clear() {
+	this->geometry.triangles.clear();
+	this->geometry.colors.clear();
+	this->geometry.varyings.clear();
+	this->geometry.textures.clear();
+	this->geometry.sources.clear();
+	this->geometry.shapeStarts.clear();
+	this->geometry.shapes = 0;
+	this->geometry.culledShapes = 0;
+	this->geometry.instances.clear();
+	this->geometry.cleared = true;
+	this->minZ = std::numeric_limits<float>::max();
+	this->maxZ = std::numeric_limits<float>::min();
+}
+
+/**
+ * @brief render the submitted triangles into the framebuffer
+ * 
+ * in pipelined mode the frame is rasterized by a background thread while the
+ * next one is submitted, getFramebuffer() then returns the previous frame
+ */
+void Scene::render() {
+	this->processGeometry();
+
+	this->finish();
+	std::swap(this->geometry, this->rasterGeometry);
+	this->geometry.triangles.clear();
+	this->geometry.colors.clear();
+	this->geometry.varyings.clear();
+	this->geometry.textures.clear();
+	this->geometry.sources.clear();
+	this->geometry.shapeStarts.clear();
+	this->geometry.shapes = 0;
+	this->geometry.culledShapes = 0;
+	this->geometry.instances.clear();
+	this->geometry.cleared = false;
+	this->instanceBvhValid = false;
+	std::swap(this->shapeLevels, this->lastShapeLevels);
+	this->shapeLevels.clear();
+	this->shapeCopies.clear();
+
+	if (!this->pipelined) {
+		this->rasterize();
+		this->collectStats();
+		return;
+	}
+
+	this->resizePresentedFramebuffer();
+	if (!this->rasterThread.joinable()) {
+		this->rasterThread = std::thread(&Scene::rasterWorker, this);
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->rasterMutex);
+		this->rasterPending = true;
+		this->rasterRunning = true;
+	}
+	this->rasterCondition.notify_all();
+}
+
+/**
+ * @brief loop of the raster thread, rasterize each frame handed by render() until the scene is destroyed
+ * 
+ */
+void Scene::rasterWorker() {
+	std::unique_lock<std::mutex> lock(this->rasterMutex);
+	while (true) {
+		this->rasterCondition.wait(lock, [this] {
+			return this->rasterStopping || this->rasterRunning;
+		});
+		if (this->rasterStopping) {
+			return;
+		}
+		lock.unlock();
+		this->rasterize();
+		lock.lock();
+		this->rasterRunning = false;
+		this->rasterCondition.notify_all();
+	}
+}
+
+/**
+ * @brief give the framebuffer of the finished frames the render size, it is only allocated in pipelined mode
+ * 
+ * a new one starts as the framebuffer does, filled with white
+ */
+void Scene::resizePresentedFramebuffer() {
+	if (
+		this->presentedFramebuffer.getWidth() != this->width ||
+		this->presentedFramebuffer.getHeight() != this->height
+	) {
+		this->presentedFramebuffer.resize(this->width, this->height);
+		this->presentedFramebuffer.fill(Color::White);
+	}
+}
+
+/**
+ * @brief wait until the frame rasterized in the background is done
+ * 
+ * the finished frame becomes the one returned by getFramebuffer()
+ */
+void Scene::finish() {
+	if (!this->rasterPending) {
+		return;
+	}
+	{
+		std::unique_lock<std::mutex> lock(this->rasterMutex);
+		this->rasterCondition.wait(lock, [this] {
+			return !this->rasterRunning;
+		});
+		this->rasterPending = false;
+	}
+	std::swap(this->framebuffer, this->presentedFramebuffer);
+	this->collectStats();
+}
+
+/**
+ * @brief return the minimum ad maximum z-buffer values
+ * 
+ * @return std::tuple<float, float> min and max z-buffer values
+ */
+std::tuple<float, float> Scene::getZbound() const {
+	return std::make_tuple(this->minZ, this->maxZ);
+}
+
+/**
+ * @brief get the render target the scene is drawn in
+ * 
+ * @return const Framebuffer& the color and depth buffers of the last finished frame
+ */
+const Framebuffer &Scene::getFramebuffer() const {
+	if (this->pipelined) {
+		return this->presentedFramebuffer;
+	}
+	return this->framebuffer;
+}
+
+/**
+ * @brief return the counters of the last rasterized frame
+ * 
+ * @return const RenderStats& the frame statistics
+ */
+const RenderStats &Scene::getStats() const {
+	return this->stats;
+}
+
+/**
+ * @brief find the triangle visible in a pixel of the last finished frame, rendered in visibility mode
+ * 
+ * @param x the pixel column
+ * @param y the pixel row
+ * @return unsigned the index of the triangle in the submission order of the frame,
+ * NO_TRIANGLE if the pixel is empty, outside the screen or the frame has no id buffer
+ */
+unsigned Scene::getTriangleAt(unsigned x, unsigned y) const {
+	const Framebuffer &framebuffer = this->getFramebuffer();
+	if (!framebuffer.hasIdBuffer() || x >= framebuffer.getWidth() || y >= framebuffer.getHeight()) {
+		return NO_TRIANGLE;
+	}
+	return framebuffer.getId(x, y);
+}
+
+/**
+ * @brief get the number of depth tests of a pixel in the last frame rasterized with the overdraw view
+ * 
+ * in pipelined mode finish() must be called first
+ * 
+ * @param x the pixel column
+ * @param y the pixel row
+ * @return unsigned the number of covering triangles that reached the depth test
+ */
+unsigned Scene::getDepthTests(unsigned x, unsigned y) const {
+	unsigned stride = this->framebuffer.getStride();
+	if (x >= this->width || y >= this->height || this->depthTests.size() != (size_t)stride * this->height) {
+		return 0;
+	}
+	return this->depthTests[y * stride + x];
+}
+
+/**
+ * @brief get the number of color writes of a pixel in the last frame rasterized with the overdraw view
+ * 
+ * @see Scene::getDepthTests
+ * @return unsigned the number of times the pixel was shaded
+ */
+unsigned Scene::getPixelWrites(unsigned x, unsigned y) const {
+	unsigned stride = this->framebuffer.getStride();
+	if (x >= this->width || y >= this->height || this->pixelWrites.size() != (size_t)stride * this->height) {
+		return 0;
+	}
+	return this->pixelWrites[y * stride + x];
+}
+/**
+ * @brief get the shapes drawn in the frame passed to the last render()
+ * 
+ * @return const std::vector<ShapeInstance>& the shapes with a vertex, in drawing order
+ */
+const std::vector<ShapeInstance> &Scene::getInstances() const {
+	return this->rasterGeometry.instances;
+}
+
+/**
+ * @brief get a hierarchy over the world space boxes of the shapes drawn in the last rendered frame
+ * 
+ * the primitives of the hierarchy are the indices in getInstances(), it is refit
+ * the first time it is requested after each frame, or rebuilt if the number of shapes changed
+ * 
+ * @return const Bvh& the hierarchy of the shape instances
+ */
+const Bvh &Scene::getInstanceBvh() {
+	if (!this->instanceBvhValid) {
+		const std::vector<ShapeInstance> &instances = this->rasterGeometry.instances;
+		this->instanceBoxes.resize(instances.size());
+		for (unsigned i = 0; i < instances.size(); i++) {
+			this->instanceBoxes[i] = instances[i].bounds;
+		}
+		this->instanceBvh.update(this->instanceBoxes);
+		this->instanceBvhValid = true;
+	}
+	return this->instanceBvh;
+}
+
+namespace {
+
+/**
+ * @brief Möller-Trumbore intersection of a ray and the front face of a triangle
+ * 
+ * a triangle faces the ray when the ray and its normal (v2 - v1) x (v3 - v1) point
+ * in opposite directions, as the triangles the clipper keeps face the camera
+ * 
+ * @param origin the origin of the ray
+ * @param direction the direction of the ray, distances are counted in its length
+ * @param vertices the 3 corners of the triangle
+ * @param u set to the weight of the second corner at the hit point
+ * @param v set to the weight of the third corner at the hit point
+ * @return float the distance of the hit, infinity if the ray misses the triangle or sees its back
+ */
+float intersectTriangle(Vector3f origin, Vector3f direction, const Vector3f *vertices, float &u, float &v) {
+	const float miss = std::numeric_limits<float>::infinity();
+	Vector3f edge1 = vertices[1] - vertices[0];
+	Vector3f edge2 = vertices[2] - vertices[0];
+	Vector3f p = direction.cross(edge2);
+	float determinant = edge1.dot(p);
+	if (!(determinant > 0)) {
+		return miss;
+	}
+	float inverse = 1 / determinant;
+	Vector3f offset = origin - vertices[0];
+	u = offset.dot(p) * inverse;
+	if (u < 0 || u > 1) {
+		return miss;
+	}
+	Vector3f q = offset.cross(edge1);
+	v = direction.dot(q) * inverse;
+	if (v < 0 || u + v > 1) {
+		return miss;
+	}
+	return edge2.dot(q) * inverse;
+}
+
+}
+
+/**
+ * @brief find the nearest triangle under a pixel
+ * 
+ * the pixel center is moved back through the inverse projection and camera
+ * matrices to a world space ray from the camera, which is intersected with the
+ * hierarchy of the shapes drawn in the last rendered frame, then with the
+ * hierarchy of the triangles of each shape it enters, nearest first, so a pick
+ * costs about the logarithm of the number of triangles
+ * 
+ * the current camera is used, the triangles between the near and far planes and
+ * facing the camera can be hit, as the ones that are rendered
+ * 
+ * @param x the pixel column
+ * @param y the pixel row
+ * @return PickResult the hit triangle, with a null shape if the pixel shows no triangle
+ */
+PickResult Scene::pick(unsigned x, unsigned y) {
+	PickResult result;
+	if (x >= this->width || y >= this->height) {
+		return result;
+	}
+
+	// the points projected on the pixel are on a line through the camera, visible ones have a positive depth
+	Vector3f projected(2 * (x + 0.5f) / this->width - 1, 2 * (y + 0.5f) / this->height - 1, 0.5f);
+	Vector3f direction = this->projectionMatrix.inverse() * projected;
+	if (direction.z < 0) {
+		direction = -direction;
+	}
+	direction.normalize();
+	float minDistance = this->near / direction.z;
+	float maxDistance = this->far / direction.z;
+	Vector3f worldDirection = this->cameraLookAtMatrix.inverse().transformDirection(direction);
+
+	const std::vector<ShapeInstance> &instances = this->rasterGeometry.instances;
+	const Vector3f &origin = this->cameraPosition;
+	float distance = this->getInstanceBvh().intersect(origin, worldDirection, minDistance, maxDistance,
+		[&](uint32_t index, float minDistance, float maxDistance) {
+			const ShapeInstance &instance = instances[index];
+			// the distances along the ray are kept in shape space since the direction is transformed without normalization
+			Matrix4 toShape;
+			if (!instance.matrix.inverse(toShape)) {
+				// a flattened shape has no volume the ray can hit
+				return maxDistance;
+			}
+			float hit = this->pickShape(instance.shape, toShape * origin, toShape.transformDirection(worldDirection), minDistance, maxDistance, result);
+			if (hit < maxDistance) {
+				result.shape = instance.shape;
+				result.instance = index;
+			}
+			return hit;
+		}
+	);
+	if (result.shape) {
+		result.distance = distance;
+		result.position = origin + worldDirection * distance;
+	}
+	return result;
+}
+
+/**
+ * @brief find the nearest triangle of a shape hit by a ray in the space of the shape
+ * 
+ * @param shape the shape to test, through its mesh hierarchy if it has one
+ * @param origin the origin of the ray
+ * @param direction the direction of the ray
+ * @param minDistance hits nearer than this distance are ignored
+ * @param maxDistance hits farther than this distance are ignored
+ * @param result its triangle and barycentric coordinates are set if a triangle is hit
+ * @return float the distance of the hit, maxDistance if no triangle is hit
+ */
+float Scene::pickShape(Shape *shape, const Vector3f &origin, const Vector3f &direction, float minDistance, float maxDistance, PickResult &result) const {
+	auto test = [&](unsigned index, const Vector3f *vertices, float minDistance, float maxDistance) {
+		float u = 0, v = 0;
+		float distance = intersectTriangle(origin, direction, vertices, u, v);
+		if (distance >= minDistance && distance < maxDistance) {
+			result.triangle = index;
+			result.u = u;
+			result.v = v;
+			return distance;
+		}
+		return maxDistance;
+	};
+
+	const Mesh *mesh = shape->getMesh();
+	if (mesh) {
+		auto meshTest = [&](uint32_t index, float minDistance, float maxDistance) {
+			const uint32_t *corners = &mesh->indices[index * 3];
+			Vector3f vertices[3] = {mesh->positions[corners[0]], mesh->positions[corners[1]], mesh->positions[corners[2]]};
+			return test(index, vertices, minDistance, maxDistance);
+		};
+		if (!mesh->bvh.empty()) {
+			return mesh->bvh.intersect(origin, direction, minDistance, maxDistance, meshTest);
+		}
+		for (unsigned i = 0; i < mesh->triangleCount(); i++) {
+			maxDistance = meshTest(i, minDistance, maxDistance);
+		}
+		return maxDistance;
+	}
+
+	std::vector<Triangle> triangles = shape->getTriangles();
+	for (unsigned i = 0; i < triangles.size(); i++) {
+		Vector3f vertices[3] = {triangles[i].v1, triangles[i].v2, triangles[i].v3};
+		maxDistance = test(i, vertices, minDistance, maxDistance);
+	}
+	return maxDistance;
+}
@@ -0,0 +1,134 @@
+#include "scene/scenenode.hpp"
+
+SceneNode::SceneNode(Shape *shape, const Matrix4 &transform) :
+	shape(shape),
+	transform(transform),
+	worldMatrix(transform),
+	dirty(true),
+	parent(nullptr)
+{}
+
+/**
+ * @brief create a node under this one
+ * 
+ * @param shape the shape of the child, nullptr for a node only grouping its own children
+ * @param transform the transform of the child relative to this node
+ * @return SceneNode* the child, owned by this node
+ */
+SceneNode *SceneNode::addChild(Shape *shape, const Matrix4 &transform) {
+	this->children.push_back(std::make_unique<SceneNode>(shape, transform));
+	SceneNode *child = this->children.back().get();
+	child->parent = this;
+	return child;
+}
+
+/**
+ * @brief delete a child of this node with all its subtree
+ * 
+ * @param child the child to delete, nothing happens if it is not a child of this node
+ */
+void SceneNode::removeChild(SceneNode *child) {
+	auto found = std::find_if(this->children.begin(), this->children.end(), [child](const std::unique_ptr<SceneNode> &node) {
+		return node.get() == child;
+	});
+	if (found != this->children.end()) {
+		this->children.erase(found);
+	}
+}
+
+/**
+ * @brief get the parent of the node
+ * 
+ * @return SceneNode* the parent, nullptr for a root
+ */
+SceneNode *SceneNode::getParent() const {
+	return this->parent;
+}
+
+/**
+ * @brief get the children of the node
+ * 
+ * @return const std::vector<std::unique_ptr<SceneNode>>& the children in drawing order
+ */
+const std::vector<std::unique_ptr<SceneNode>> &SceneNode::getChildren() const {
+	return this->children;
+}
+
+/**
+ * @brief set the shape drawn by the node
+ * 
+ * @param shape the shape, nullptr to draw nothing
+ */
+void SceneNode::setShape(Shape *shape) {
+	this->shape = shape;
+	this->geometry.valid = false;
+}
+
+/**
+ * @brief get the shape drawn by the node
+ * 
+ * @return Shape* the shape, nullptr if the node has none
+ */
+Shape *SceneNode::getShape() const {
+	return this->shape;
+}
+
+/**
+ * @brief set the transform of the node relative to its parent, the subtree is marked dirty
+ * 
+ * @param transform the new transform
+ */
+void SceneNode::setTransform(const Matrix4 &transform) {
+	this->transform = transform;
+	this->setDirty();
+}
+
+/**
+ * @brief get the transform of the node relative to its parent
+ * 
+ * @return const Matrix4& the transform
+ */
+const Matrix4 &SceneNode::getTransform() const {
+	return this->transform;
+}
+
+/**
+ * @brief get the product of the transforms from the root to this node
+ * 
+ * the matrix is computed again if the node is dirty, after the matrices of its
+ * dirty parents, the cached triangles of the node are then out of date
+ * 
+ * @return const Matrix4& the world matrix
+ */
+const Matrix4 &SceneNode::getWorldMatrix() {
+	if (this->dirty) {
+		this->worldMatrix = this->parent ? this->parent->getWorldMatrix() * this->transform : this->transform;
+		this->dirty = false;
+		this->geometry.valid = false;
+	}
+	return this->worldMatrix;
+}
+
+/**
+ * @brief check if the world matrix must be computed again
+ * 
+ * @return bool true if the node or one of its parents moved since its world matrix was computed
+ */
+bool SceneNode::isDirty() const {
+	return this->dirty;
+}
+
+/**
+ * @brief mark the node and its subtree dirty
+ * 
+ * the subtrees already dirty are skipped: their nodes were all marked with them
+ */
+void SceneNode::setDirty() {
+	if (this->dirty) {
+		return;
+	}
+	this->dirty = true;
+	for (std::unique_ptr<SceneNode> &child : this->children) {
+		child->setDirty();
+	}
+}
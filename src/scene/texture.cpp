@@ -0,0 +1,317 @@
+#include "scene/texture.hpp"
+
+/**
+ * @brief create an empty texture, it must be created or loaded before it is sampled
+ * 
+ */
+Texture::Texture() {}
+
+/**
+ * @brief create a texture from an image
+ * 
+ * @see Texture::create
+ */
+Texture::Texture(unsigned width, unsigned height, const uint8_t *pixels) {
+	this->create(width, height, pixels);
+}
+
+namespace {
+
+/**
+ * @brief spread the bits of a number so a zero bit is between each of them
+ * 
+ * @param value the number to spread, only its 16 low bits are used
+ * @return uint32_t the bit i of the value is the bit 2 * i of the result
+ */
+uint32_t spreadBits(uint32_t value) {
+	uint32_t spread = 0;
+	for (int i = 0; i < 16; i++) {
+		spread |= ((value >> i) & 1) << (2 * i);
+	}
+	return spread;
+}
+
+}
+
+/**
+ * @brief replace the texture with an image and compute its mip chain
+ * 
+ * an image whose sizes are not powers of two is bilinearly resampled to the next ones
+ * 
+ * @param width the image width in pixels
+ * @param height the image height in pixels
+ * @param pixels width * height RGBA8 pixels, row by row from the top of the image
+ */
+void Texture::create(unsigned width, unsigned height, const uint8_t *pixels) {
+	if (width == 0 || height == 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE) {
+		throw std::runtime_error("Texture::create: invalid size");
+	}
+	unsigned levelWidth = 1, levelHeight = 1;
+	while (levelWidth < width) {
+		levelWidth *= 2;
+	}
+	while (levelHeight < height) {
+		levelHeight *= 2;
+	}
+
+	std::vector<uint32_t> image(levelWidth * levelHeight);
+	if (levelWidth == width && levelHeight == height) {
+		std::memcpy(image.data(), pixels, image.size() * 4);
+	} else {
+		for (unsigned y = 0; y < levelHeight; y++) {
+			float sourceY = std::max(0.0f, (y + 0.5f) * height / levelHeight - 0.5f);
+			unsigned y0 = std::min<unsigned>(sourceY, height - 1);
+			unsigned y1 = std::min(y0 + 1, height - 1);
+			float weightY = sourceY - y0;
+			for (unsigned x = 0; x < levelWidth; x++) {
+				float sourceX = std::max(0.0f, (x + 0.5f) * width / levelWidth - 0.5f);
+				unsigned x0 = std::min<unsigned>(sourceX, width - 1);
+				unsigned x1 = std::min(x0 + 1, width - 1);
+				float weightX = sourceX - x0;
+				uint8_t texel[4];
+				for (int c = 0; c < 4; c++) {
+					float top = pixels[(y0 * width + x0) * 4 + c] * (1 - weightX) + pixels[(y0 * width + x1) * 4 + c] * weightX;
+					float bottom = pixels[(y1 * width + x0) * 4 + c] * (1 - weightX) + pixels[(y1 * width + x1) * 4 + c] * weightX;
+					texel[c] = std::lrint(top * (1 - weightY) + bottom * weightY);
+				}
+				std::memcpy(&image[y * levelWidth + x], texel, 4);
+			}
+		}
+	}
+
+	this->texels.clear();
+	this->mortonX.clear();
+	this->mortonY.clear();
+	this->levels.clear();
+	this->addLevel(image, levelWidth, levelHeight);
+
+	// each level is the 2x2 box filter of the previous one
+	while (levelWidth > 1 || levelHeight > 1) {
+		unsigned nextWidth = std::max(1u, levelWidth / 2);
+		unsigned nextHeight = std::max(1u, levelHeight / 2);
+		unsigned stepX = levelWidth > 1 ? 1 : 0;
+		unsigned stepY = levelHeight > 1 ? levelWidth : 0;
+		std::vector<uint32_t> next(nextWidth * nextHeight);
+		for (unsigned y = 0; y < nextHeight; y++) {
+			for (unsigned x = 0; x < nextWidth; x++) {
+				unsigned index = (y * stepY + x * stepX) * 2;
+				uint8_t quad[4][4];
+				std::memcpy(quad[0], &image[index], 4);
+				std::memcpy(quad[1], &image[index + stepX], 4);
+				std::memcpy(quad[2], &image[index + stepY], 4);
+				std::memcpy(quad[3], &image[index + stepX + stepY], 4);
+				uint8_t texel[4];
+				for (int c = 0; c < 4; c++) {
+					texel[c] = (quad[0][c] + quad[1][c] + quad[2][c] + quad[3][c] + 2) / 4;
+				}
+				std::memcpy(&next[y * nextWidth + x], texel, 4);
+			}
+		}
+		image.swap(next);
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+		this->addLevel(image, levelWidth, levelHeight);
+	}
+}
+
+/**
+ * @brief append a mip level, its texels are stored in Morton order
+ * 
+ * when the level is not square, the bits of the smallest size are interleaved
+ * and the remaining bits of the biggest one are put above them
+ * 
+ * @param image the level texels row by row
+ * @param width the level width, a power of two
+ * @param height the level height, a power of two
+ */
+void Texture::addLevel(const std::vector<uint32_t> &image, unsigned width, unsigned height) {
+	Level level = {width, height, (unsigned)this->texels.size(), (unsigned)this->mortonX.size(), (unsigned)this->mortonY.size()};
+	this->levels.push_back(level);
+
+	unsigned bits = 0;
+	while ((1u << (bits + 1)) <= std::min(width, height)) {
+		bits++;
+	}
+	uint32_t mask = (1u << bits) - 1;
+	for (uint32_t x = 0; x < width; x++) {
+		this->mortonX.push_back(spreadBits(x & mask) | ((x >> bits) << (2 * bits)));
+	}
+	for (uint32_t y = 0; y < height; y++) {
+		this->mortonY.push_back((spreadBits(y & mask) << 1) | ((y >> bits) << (2 * bits)));
+	}
+
+	this->texels.resize(this->texels.size() + width * height);
+	for (unsigned y = 0; y < height; y++) {
+		for (unsigned x = 0; x < width; x++) {
+			this->texels[level.offset + this->mortonX[level.xOffset + x] + this->mortonY[level.yOffset + y]] = image[y * width + x];
+		}
+	}
+}
+
+/**
+ * @brief load a binary PPM (P6) or a truecolor TGA image, uncompressed or run length encoded
+ * 
+ * @param fileName the path to the image
+ */
+void Texture::loadFromFile(const std::string &fileName) {
+	std::ifstream file(fileName, std::ios::binary);
+	if (file.fail()) {
+		throw std::runtime_error("Texture::loadFromFile: Failled to open file " + fileName);
+	}
+
+	std::vector<uint8_t> pixels;
+	unsigned width, height;
+	std::string extension = fileName.substr(fileName.find_last_of(".") + 1);
+	for (char &c : extension) {
+		c = std::tolower(c);
+	}
+	if (file.peek() == 'P') {
+		this->readPPM(file, pixels, width, height);
+	} else if (extension == "tga") {
+		this->readTGA(file, pixels, width, height);
+	} else {
+		throw std::runtime_error("Texture::loadFromFile: Unsupported image format " + fileName);
+	}
+	if (file.fail()) {
+		throw std::runtime_error("Texture::loadFromFile: Truncated image " + fileName);
+	}
+	this->create(width, height, pixels.data());
+}
+
+/**
+ * @brief read a binary PPM image with 8 bit channels
+ * 
+ * @param file the image stream, at its beginning
+ * @param pixels filled with the RGBA8 pixels
+ * @param width the read image width
+ * @param height the read image height
+ */
+void Texture::readPPM(std::ifstream &file, std::vector<uint8_t> &pixels, unsigned &width, unsigned &height) {
+	// header fields are separated by whitespaces and comments
+	auto readField = [&file]() {
+		std::string field;
+		while (file >> field && field[0] == '#') {
+			file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+		}
+		return field;
+	};
+
+	if (readField() != "P6") {
+		throw std::runtime_error("Texture::readPPM: Only binary PPM (P6) images are supported");
+	}
+	unsigned maxValue;
+	try {
+		width = std::stoul(readField());
+		height = std::stoul(readField());
+		maxValue = std::stoul(readField());
+	} catch (const std::exception &e) {
+		throw std::runtime_error("Texture::readPPM: Invalid header");
+	}
+	if (maxValue != 255 || width == 0 || height == 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE) {
+		throw std::runtime_error("Texture::readPPM: Unsupported image size or channel depth");
+	}
+	file.get(); // single whitespace before the pixels
+
+	std::vector<uint8_t> rgb(width * height * 3);
+	file.read((char *)rgb.data(), rgb.size());
+	pixels.resize(width * height * 4);
+	for (unsigned i = 0; i < width * height; i++) {
+		pixels[i * 4] = rgb[i * 3];
+		pixels[i * 4 + 1] = rgb[i * 3 + 1];
+		pixels[i * 4 + 2] = rgb[i * 3 + 2];
+		pixels[i * 4 + 3] = 255;
+	}
+}
+
+/**
+ * @brief read a 24 or 32 bit truecolor TGA image, uncompressed or run length encoded
+ * 
+ * @see Texture::readPPM
+ */
+void Texture::readTGA(std::ifstream &file, std::vector<uint8_t> &pixels, unsigned &width, unsigned &height) {
+	uint8_t header[18];
+	file.read((char *)header, sizeof(header));
+	unsigned imageType = header[2];
+	unsigned bytesPerPixel = header[16] / 8;
+	width = header[12] | header[13] << 8;
+	height = header[14] | header[15] << 8;
+	if (file.fail() || header[1] != 0 || (imageType != 2 && imageType != 10) || (bytesPerPixel != 3 && bytesPerPixel != 4)) {
+		throw std::runtime_error("Texture::readTGA: Only 24 and 32 bit truecolor images are supported");
+	}
+	if (width == 0 || height == 0) {
+		throw std::runtime_error("Texture::readTGA: Invalid image size");
+	}
+	file.ignore(header[0]); // image id
+
+	// pixels are stored in BGR(A) order
+	pixels.resize(width * height * 4);
+	auto readPixel = [&file, bytesPerPixel](uint8_t *pixel) {
+		uint8_t bgra[4] = {0, 0, 0, 255};
+		file.read((char *)bgra, bytesPerPixel);
+		pixel[0] = bgra[2];
+		pixel[1] = bgra[1];
+		pixel[2] = bgra[0];
+		pixel[3] = bgra[3];
+	};
+	unsigned count = width * height;
+	if (imageType == 2) {
+		for (unsigned i = 0; i < count; i++) {
+			readPixel(&pixels[i * 4]);
+		}
+	} else {
+		// packets of a repeated pixel or of raw pixels
+		unsigned i = 0;
+		while (i < count && file.good()) {
+			uint8_t packet = file.get();
+			unsigned length = std::min((packet & 0x7f) + 1u, count - i);
+			if (packet & 0x80) {
+				readPixel(&pixels[i * 4]);
+				for (unsigned j = 1; j < length; j++) {
+					std::memcpy(&pixels[(i + j) * 4], &pixels[i * 4], 4);
+				}
+			} else {
+				for (unsigned j = 0; j < length; j++) {
+					readPixel(&pixels[(i + j) * 4]);
+				}
+			}
+			i += length;
+		}
+	}
+
+	// rows are stored from the bottom unless the origin is at the top
+	if (!(header[17] & 0x20)) {
+		for (unsigned y = 0; y < height / 2; y++) {
+			std::swap_ranges(
+				pixels.begin() + y * width * 4, pixels.begin() + (y + 1) * width * 4,
+				pixels.begin() + (height - 1 - y) * width * 4
+			);
+		}
+	}
+}
+
+/**
+ * @brief get the width of the first level
+ * 
+ * @return unsigned the width in texels, a power of two
+ */
+unsigned Texture::getWidth() const {
+	return this->levels.empty() ? 0 : this->levels[0].width;
+}
+
+/**
+ * @brief get the height of the first level
+ * 
+ * @return unsigned the height in texels, a power of two
+ */
+unsigned Texture::getHeight() const {
+	return this->levels.empty() ? 0 : this->levels[0].height;
+}
+
+/**
+ * @brief get the number of mip levels
+ * 
+ * @return unsigned the number of levels, down to 1x1
+ */
+unsigned Texture::getLevelCount() const {
+	return this->levels.size();
+}
@@ -0,0 +1,104 @@
+#include "scene/threadpool.hpp"
+
+ThreadPool::ThreadPool(unsigned threads) :
+	task(nullptr),
+	taskCount(0),
+	nextTask(0),
+	activeWorkers(0),
+	generation(0),
+	stopping(false)
+{
+	// the caller is the first thread
+	for (unsigned i = 1; i < threads; i++) {
+		this->workers.emplace_back(&ThreadPool::worker, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+	this->startCondition.notify_all();
+	for (std::thread &thread : this->workers) {
+		thread.join();
+	}
+}
+
+/**
+ * @brief return the number of threads working on each run, caller included
+ * 
+ * @return unsigned the thread count
+ */
+unsigned ThreadPool::getThreadCount() const {
+	return this->workers.size() + 1;
+}
+
+/**
+ * @brief call task(i) for each i in [0, tasks) on all threads and wait for the end
+ * 
+ * tasks are distributed dynamically so they should be independent from each other
+ * 
+ * @param tasks the number of tasks
+ * @param task the function to run for each task index
+ */
+void ThreadPool::run(unsigned tasks, const std::function<void(unsigned)> &task) {
+	if (tasks == 0) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->task = &task;
+		this->taskCount = tasks;
+		this->nextTask = 0;
+		this->activeWorkers = this->workers.size();
+		this->generation++;
+	}
+	this->startCondition.notify_all();
+
+	this->runTasks();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->doneCondition.wait(lock, [this] { return this->activeWorkers == 0; });
+	this->task = nullptr;
+}
+
+/**
+ * @brief take tasks until there is none left
+ * 
+ */
+void ThreadPool::runTasks() {
+	unsigned index;
+	while ((index = this->nextTask++) < this->taskCount) {
+		(*this->task)(index);
+	}
+}
+
+/**
+ * @brief worker thread loop, wait for a new run then help with its tasks
+ * 
+ */
+void ThreadPool::worker() {
+	unsigned long lastGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->startCondition.wait(lock, [this, lastGeneration] {
+				return this->stopping || this->generation != lastGeneration;
+			});
+			if (this->stopping) {
+				return;
+			}
+			lastGeneration = this->generation;
+		}
+
+		this->runTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->activeWorkers--;
+		}
+		this->doneCondition.notify_one();
+	}
+}
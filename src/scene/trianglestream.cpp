@@ -0,0 +1,160 @@
+#include "scene/trianglestream.hpp"
+
+TriangleStream::TriangleStream() :
+	count(0)
+{}
+
+/**
+ * @brief get the number of triangles
+ * 
+ * @return unsigned the number of pushed triangles
+ */
+unsigned TriangleStream::size() const {
+	return this->count;
+}
+
+/**
+ * @brief get the number of triangles rounded up to the padding
+ * 
+ * @return unsigned the size of the arrays that can be read, a multiple of STREAM_PADDING
+ */
+unsigned TriangleStream::paddedSize() const {
+	return (this->count + STREAM_PADDING - 1) / STREAM_PADDING * STREAM_PADDING;
+}
+
+/**
+ * @brief remove all the triangles, the arrays keep their capacity
+ * 
+ */
+void TriangleStream::clear() {
+	this->count = 0;
+}
+
+/**
+ * @brief exchange the triangles of two streams without copying them
+ * 
+ * @param other the stream to swap with
+ */
+void TriangleStream::swap(TriangleStream &other) {
+	for (unsigned corner = 0; corner < 3; corner++) {
+		this->x[corner].swap(other.x[corner]);
+		this->y[corner].swap(other.y[corner]);
+		this->z[corner].swap(other.z[corner]);
+	}
+	std::swap(this->count, other.count);
+}
+
+/**
+ * @brief add a triangle at the end of the stream
+ * 
+ * the padding after the triangle is zeroed when it starts a new block, the
+ * loops running up to the padded size never read stale or infinite values
+ * 
+ * @param v1 the first corner
+ * @param v2 the second corner
+ * @param v3 the third corner
+ */
+void TriangleStream::push(const Vector3f &v1, const Vector3f &v2, const Vector3f &v3) {
+	if (this->count % STREAM_PADDING == 0) {
+		unsigned padded = this->count + STREAM_PADDING;
+		for (unsigned corner = 0; corner < 3; corner++) {
+			for (AlignedFloats *array : {&this->x[corner], &this->y[corner], &this->z[corner]}) {
+				if (array->size() < padded) {
+					array->resize(padded);
+				}
+				std::fill(array->begin() + this->count, array->begin() + padded, 0.0f);
+			}
+		}
+	}
+
+	const Vector3f *vertices[3] = {&v1, &v2, &v3};
+	for (unsigned corner = 0; corner < 3; corner++) {
+		this->x[corner][this->count] = vertices[corner]->x;
+		this->y[corner][this->count] = vertices[corner]->y;
+		this->z[corner][this->count] = vertices[corner]->z;
+	}
+	this->count++;
+}
+
+/**
+ * @brief add a copy of a triangle of another stream
+ * 
+ * @param other the stream to copy from
+ * @param index the index of the triangle in the other stream
+ */
+void TriangleStream::push(const TriangleStream &other, unsigned index) {
+	this->push(other.vertex(index, 0), other.vertex(index, 1), other.vertex(index, 2));
+}
+
+/**
+ * @brief add a copy of all the triangles of another stream at the end of this one
+ * 
+ * each array is copied at once and the padding after the last triangle is zeroed
+ * 
+ * @param other the stream to copy from
+ */
+void TriangleStream::append(const TriangleStream &other) {
+	unsigned end = this->count + other.count;
+	unsigned padded = (end + STREAM_PADDING - 1) / STREAM_PADDING * STREAM_PADDING;
+	for (unsigned corner = 0; corner < 3; corner++) {
+		AlignedFloats *arrays[3] = {&this->x[corner], &this->y[corner], &this->z[corner]};
+		const AlignedFloats *others[3] = {&other.x[corner], &other.y[corner], &other.z[corner]};
+		for (unsigned i = 0; i < 3; i++) {
+			if (arrays[i]->size() < padded) {
+				arrays[i]->resize(padded);
+			}
+			std::copy(others[i]->begin(), others[i]->begin() + other.count, arrays[i]->begin() + this->count);
+			std::fill(arrays[i]->begin() + end, arrays[i]->begin() + padded, 0.0f);
+		}
+	}
+	this->count = end;
+}
+
+/**
+ * @brief add a copy of some triangles of another stream at the end of this one
+ * 
+ * each array is gathered at once and the padding after the last triangle is zeroed
+ * 
+ * @param other the stream to copy from
+ * @param indices the indices of the triangles to copy in the other stream
+ * @param count the number of indices
+ */
+void TriangleStream::append(const TriangleStream &other, const uint32_t *indices, unsigned count) {
+	unsigned end = this->count + count;
+	unsigned padded = (end + STREAM_PADDING - 1) / STREAM_PADDING * STREAM_PADDING;
+	for (unsigned corner = 0; corner < 3; corner++) {
+		AlignedFloats *arrays[3] = {&this->x[corner], &this->y[corner], &this->z[corner]};
+		const AlignedFloats *others[3] = {&other.x[corner], &other.y[corner], &other.z[corner]};
+		for (unsigned i = 0; i < 3; i++) {
+			if (arrays[i]->size() < padded) {
+				arrays[i]->resize(padded);
+			}
+			float *destination = arrays[i]->data() + this->count;
+			const float *source = others[i]->data();
+			for (unsigned j = 0; j < count; j++) {
+				destination[j] = source[indices[j]];
+			}
+			std::fill(arrays[i]->begin() + end, arrays[i]->begin() + padded, 0.0f);
+		}
+	}
+	this->count = end;
+}
+
+/**
+ * @brief transform the triangles from an index to the end of the stream
+ * 
+ * the padding is transformed too so the batch has no scalar tail, the last row of
+ * the matrix is ignored: it must be affine, as the world and camera matrices are
+ * 
+ * @param matrix the affine transformation
+ * @param first the index of the first triangle to transform
+ */
+void TriangleStream::transform(const Matrix4 &matrix, unsigned first) {
+	unsigned end = this->paddedSize();
+	if (first >= end) {
+		return;
+	}
+	for (unsigned corner = 0; corner < 3; corner++) {
+		matrix.transformPoints(this->x[corner].data() + first, this->y[corner].data() + first, this->z[corner].data() + first, end - first);
+	}
+}
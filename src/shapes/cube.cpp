@@ -27,47 +27,84 @@ const Vector3f vertex_pos[] {
 	Vector3f(-1, -1, -1), Vector3f(1, -1, 1), Vector3f(-1, -1, 1)
 };
 
+namespace {
+
+/**
+ * @brief texture coordinates of a cube corner, each face shows the whole texture
+ * 
+ * @param position the corner position
+ * @param face the id of the face in order front, back, right, left, top, bottom
+ * @return Vector2f the texture coordinates of the corner on this face
+ */
+Vector2f cubeTexCoord(const Vector3f &position, unsigned face) {
+	if (face < 2) {
+		return Vector2f((position.x + 1) / 2, (1 - position.y) / 2);
+	}
+	if (face < 4) {
+		return Vector2f((position.z + 1) / 2, (1 - position.y) / 2);
+	}
+	return Vector2f((position.x + 1) / 2, (position.z + 1) / 2);
+}
+
+}
+
 Cube::Cube(Vector3f size) : 
 	Shape(size),
-	color(sf::Color::White)
+	color(Color::White)
 {
 	this->init();
 }
 
 void Cube::shape_init() {
+	Vector3f positions[36];
+	this->transformVertices(positions);
 	this->triangles.resize(12);
 	for (int i = 0; i < 12; i ++) {
-		this->triangles.at(i) = Triangle({
-			this->rotationMatrix * (vertex_pos[i * 3] * size),
-			this->rotationMatrix * (vertex_pos[i * 3 + 1] * size),
-			this->rotationMatrix * (vertex_pos[i * 3 + 2] * size),
-		});
+		this->triangles.at(i) = Triangle({positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]});
 		this->triangles.at(i).calculateNormal();
+		for (int j = 0; j < 3; j++) {
+			this->triangles.at(i).uvs[j] = cubeTexCoord(vertex_pos[i * 3 + j], i / 2);
+		}
 	}
-	this->colors.resize(12, sf::Color(this->color));
+	this->colors.resize(12, Color(this->color));
 }
 
 void Cube::shape_update() {
+	Vector3f positions[36];
+	this->transformVertices(positions);
 	for (int i = 0; i < 36; i += 3) {
 		Triangle *t = &this->triangles[i / 3];
-		t->v1 = this->rotationMatrix * (vertex_pos[i] * size);
-		t->v2 = this->rotationMatrix * (vertex_pos[i + 1] * size);
-		t->v3 = this->rotationMatrix * (vertex_pos[i + 2] * size);
+		t->v1 = positions[i];
+		t->v2 = positions[i + 1];
+		t->v3 = positions[i + 2];
 		t->calculateNormal();
 	}
 }
 
+/**
+ * @brief scale and rotate the 36 vertices of the cube triangles in one batch
+ * 
+ * @param positions filled with the transformed vertices, in the order of vertex_pos
+ */
+void Cube::transformVertices(Vector3f *positions) const {
+	for (int i = 0; i < 36; i++) {
+		positions[i] = vertex_pos[i] * this->size;
+	}
+	this->rotationMatrix.transformPoints(positions, positions, 36, true);
+}
+
 /**
  * @brief set the color of a specific face
  * 
  * @param face the id of the face in order front, back, right, left, top, bottom
  * @param color the color to set
  */
-void Cube::setFaceColor(const unsigned face, const sf::Color color) {
+void Cube::setFaceColor(const unsigned face, const Color color) {
 	if (face > 5) {
 		throw std::out_of_range("Face index out of range");
 	}
 	this->colors[face] = color;
+	this->revision++;
 }
 
 /**
@@ -75,8 +112,23 @@ void Cube::setFaceColor(const unsigned face, const sf::Color color) {
  * 
  * @param colors color to set
  */
-void Cube::setFacesColors(const sf::Color colors[6]) {
+void Cube::setFacesColors(const Color colors[6]) {
 	for (int j = 0; j < 12; j++) {
 		this->colors.at(j) = colors[j/2];
 	}
+	this->revision++;
+}
+
+/**
+ * @brief map a texture on each face, the face colors are not used while it is set
+ * 
+ * @param texture the texture to map, nullptr to use the face colors
+ */
+void Cube::setTexture(std::shared_ptr<const Texture> texture) {
+	if (texture) {
+		this->textures.assign(12, texture);
+	} else {
+		this->textures.clear();
+	}
+	this->revision++;
 }
\ No newline at end of file
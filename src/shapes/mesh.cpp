@@ -0,0 +1,59 @@
+#include "shapes/mesh.hpp"
+
+/**
+ * @brief get the number of triangles
+ * 
+ * @return unsigned the number of index triplets
+ */
+unsigned Mesh::triangleCount() const {
+	return this->indices.size() / 3;
+}
+
+/**
+ * @brief copy the vertices of a triangle into a standalone triangle
+ * 
+ * @param index the triangle index
+ * @return Triangle the triangle with its normal, vertex normals and texture coordinates
+ */
+Triangle Mesh::getTriangle(unsigned index) const {
+	Triangle triangle;
+	for (unsigned i = 0; i < 3; i++) {
+		uint32_t vertex = this->indices[index * 3 + i];
+		triangle(i) = this->positions[vertex];
+		triangle.vertexNormals[i] = this->normals[vertex];
+		triangle.uvs[i] = this->uvs[vertex];
+	}
+	triangle.calculateNormal();
+	return triangle;
+}
+
+/**
+ * @brief compute the face normal of each triangle from its vertices
+ * 
+ */
+void Mesh::computeFaceNormals() {
+	unsigned count = this->triangleCount();
+	this->faceNormals.resize(count);
+	for (unsigned i = 0; i < count; i++) {
+		const Vector3f &v1 = this->positions[this->indices[i * 3]];
+		const Vector3f &v2 = this->positions[this->indices[i * 3 + 1]];
+		const Vector3f &v3 = this->positions[this->indices[i * 3 + 2]];
+		this->faceNormals[i] = (v2 - v1).cross(v3 - v1);
+	}
+}
+
+/**
+ * @brief remove all the vertices and the triangles
+ * 
+ */
+void Mesh::clear() {
+	this->positions.clear();
+	this->normals.clear();
+	this->uvs.clear();
+	this->indices.clear();
+	this->faceNormals.clear();
+	this->colors.clear();
+	this->textures.clear();
+	this->bvh.clear();
+	this->error = 0;
+}
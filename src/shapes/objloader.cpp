@@ -3,7 +3,13 @@
 ObjLoader::ObjLoader(Vector3f size) : Shape(size), objLoaded(false) {}
 ObjLoader::ObjLoader(const ObjLoader& other) : 
 	Shape(other),  
-	objLoaded(other.objLoaded)
+	objLoaded(other.objLoaded),
+	mesh(other.mesh),
+	objPositions(other.objPositions),
+	objNormals(other.objNormals),
+	levels(other.levels),
+	levelVertices(other.levelVertices),
+	levelErrors(other.levelErrors)
 {}
 
 /**
@@ -104,6 +110,18 @@ bool ObjLoader::parseMTL(std::string &lineType) {
 		}
 		if (elems[0] == "newmtl") {
 			materialName = elems[1];
+			this->materialColors[materialName] = Color::White;
+		} else if (elems[0] == "map_Kd") {
+			if (materialName.size() == 0) {
+				this->errorMessage = "ObjLoader::parseMTL: Expected 'newmtl' before 'map_Kd'";
+				mtlFile.close();
+				return false;
+			}
+			// the options come before the file name
+			if (!this->loadTexture(materialName, elems.back())) {
+				mtlFile.close();
+				return false;
+			}
 		} else if (elems[0] == "Kd") {
 			if (materialName.size() == 0) {
 				this->errorMessage = "ObjLoader::parseMTL: Expected 'newmtl' before 'Kd'";
@@ -111,7 +129,7 @@ bool ObjLoader::parseMTL(std::string &lineType) {
 				return false;
 			}
 			try {
-				this->materialColors[materialName] = sf::Color(
+				this->materialColors[materialName] = Color(
 					std::stof(elems[1]) * 255,
 					std::stof(elems[2]) * 255,
 					std::stof(elems[3]) * 255
@@ -128,6 +146,27 @@ bool ObjLoader::parseMTL(std::string &lineType) {
 	return true;
 }
 
+/**
+ * @brief load the diffuse texture of a material
+ * 
+ * @param materialName the material using the texture
+ * @param textureFile the image path, relative to the obj file
+ * @return bool true if the image was loaded
+ */
+bool ObjLoader::loadTexture(const std::string &materialName, const std::string &textureFile) {
+	std::string texturePath = this->fileName.substr(0, this->fileName.find_last_of("/") + 1);
+	texturePath += textureFile;
+	try {
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+		texture->loadFromFile(texturePath);
+		this->materialTextures[materialName] = texture;
+	} catch (const std::exception &e) {
+		this->errorMessage = "ObjLoader::parseMTL: Failed to load texture :" + std::string(e.what());
+		return false;
+	}
+	return true;
+}
+
 /**
  * @brief set the current color to the material color if one is specified
  * 
@@ -149,6 +188,8 @@ bool ObjLoader::setMTL(std::string &lineType) {
 	}
 
 	this->currentColor = this->materialColors[materialName];
+	auto texture = this->materialTextures.find(materialName);
+	this->currentTexture = texture == this->materialTextures.end() ? nullptr : texture->second;
 	return true;
 }
 
@@ -174,7 +215,17 @@ bool ObjLoader::parseVertex(std::string &lineType) {
 	}
 
 	if (lineType == "vt") {
-		this->file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+		// the optional w coordinate is ignored, v is flipped to go down the image rows
+		std::string line;
+		std::getline(this->file, line);
+		std::istringstream coordinates(line);
+		Vector2f texCoord;
+		if (!(coordinates >> texCoord.x >> texCoord.y)) {
+			this->errorMessage = "ObjLoader::parseVertex: Invalid texture coordinates " + line;
+			return false;
+		}
+		texCoord.y = 1 - texCoord.y;
+		texCoords.push_back(texCoord);
 		return true;
 	}
 	
@@ -185,6 +236,9 @@ bool ObjLoader::parseVertex(std::string &lineType) {
 /**
  * @brief Parce a face line, it only supports triangles for now
  * 
+ * each distinct position, texture coordinates and normal triplet becomes one
+ * vertex of the mesh, shared by all the faces using it
+ * 
  * @param lineType the beginning of the line, must be f
  * @return bool true if the line syntax is correct
  */
@@ -201,30 +255,47 @@ bool ObjLoader::parseFace(std::string &lineType) {
 		return false;
 	}
 
-	Triangle triangle;
+	uint32_t corners[3];
 	std::vector<std::string> vertexInfo;
 	for (int i = 0; i < 3; i++) {
+		// v, v/vt, v//vn or v/vt/vn, a missing index is -1
 		vertexInfo = split(vertex[i], '/');
 		try {
-			triangle(i) = this->verticles[std::stoi(vertexInfo[0]) - 1];
-		} catch (const std::invalid_argument &err) {
-			this->errorMessage = "ObjLoader::loadFile: Invalid numerical value" + vertexInfo[0];
-			return false;
-		}
-	}
+			int index = std::stoi(vertexInfo[0]) - 1;
+			int texCoordIndex = -1, normalIndex = -1;
+			const Vector3f &position = this->verticles.at(index);
+			Vector2f texCoord;
+			Vector3f normal;
+			if (vertexInfo.size() >= 2 && vertexInfo[1].size() > 0) {
+				texCoordIndex = std::stoi(vertexInfo[1]) - 1;
+				texCoord = this->texCoords.at(texCoordIndex);
+			}
+			if (vertexInfo.size() == 3 && vertexInfo[2].size() > 0) {
+				normalIndex = std::stoi(vertexInfo[2]) - 1;
+				normal = this->normals.at(normalIndex);
+			}
 
-	if (vertexInfo.size() == 2 && vertexInfo[1].size() > 0) {
-		try {
-			triangle.normal = this->normals[std::stoi(vertexInfo[1]) - 1];
+			auto inserted = this->meshVertices.emplace(std::make_tuple(index, texCoordIndex, normalIndex), this->mesh.positions.size());
+			if (inserted.second) {
+				this->mesh.positions.push_back(position);
+				this->mesh.uvs.push_back(texCoord);
+				this->mesh.normals.push_back(normal);
+				this->objIndices.push_back(index);
+			}
+			corners[i] = inserted.first->second;
 		} catch (const std::invalid_argument &err) {
-			this->errorMessage = "ObjLoader::loadFile: Invalid numerical value" + vertexInfo[1];
+			this->errorMessage = "ObjLoader::loadFile: Invalid numerical value " + vertex[i];
+			return false;
+		} catch (const std::out_of_range &err) {
+			this->errorMessage = "ObjLoader::loadFile: Index out of range " + vertex[i];
 			return false;
 		}
 	}
 
 	// add triangle to the list
-	this->objTriangles.push_back(triangle);
-	this->objColors.push_back(this->currentColor);
+	this->mesh.indices.insert(this->mesh.indices.end(), corners, corners + 3);
+	this->mesh.colors.push_back(this->currentColor);
+	this->mesh.textures.push_back(this->currentTexture);
 	return true;
 }
 
@@ -242,8 +313,16 @@ void ObjLoader::loadObjFile(const std::string &fileName) {
 
 	this->objLoaded = false;
 	this->verticles.clear();
+	this->normals.clear();
+	this->mesh.clear();
+	this->meshVertices.clear();
+	this->objIndices.clear();
+	this->texCoords.clear();
+	this->materialColors.clear();
+	this->materialTextures.clear();
 	this->errorLine = 0;
-	this->currentColor = sf::Color::White;
+	this->currentColor = Color::White;
+	this->currentTexture = nullptr;
 	std::getline(this->file, lineStart, ' ');
 	while (parserResult && !this->file.eof()) {
 		this->errorLine++;
@@ -280,41 +359,243 @@ void ObjLoader::loadObjFile(const std::string &fileName) {
 		std::getline(this->file, lineStart, ' ');
 	}
 	this->file.close();
-	this->verticles.clear();
+	if (parserResult) {
+		this->smoothNormals();
+	} else {
+		this->mesh.clear();
+	}
+	// the parsing lists are released, only the mesh is kept
+	std::vector<Vector3f>().swap(this->verticles);
+	std::vector<Vector3f>().swap(this->normals);
+	std::vector<Vector2f>().swap(this->texCoords);
+	std::vector<unsigned>().swap(this->objIndices);
+	this->meshVertices.clear();
+	// untextured files keep an empty texture list
+	if (std::all_of(this->mesh.textures.begin(), this->mesh.textures.end(), [](const std::shared_ptr<const Texture> &texture) { return !texture; })) {
+		this->mesh.textures.clear();
+	}
+	this->objPositions = this->mesh.positions;
+	this->objNormals = this->mesh.normals;
+	this->buildLevels();
 	this->objLoaded = parserResult;
 	this->updateNeeded = parserResult;
 	if (this->objLoaded)
 		this->init();
 }
 
+/**
+ * @brief give a normal to the vertices the file has no normal for
+ * 
+ * the normal of a vertex is the average of the normals of the faces sharing it,
+ * weighted by their area, so the shape looks smooth with Gouraud shading
+ */
+void ObjLoader::smoothNormals() {
+	const Mesh &mesh = this->mesh;
+	std::vector<Vector3f> vertexNormals(this->verticles.size());
+	for (unsigned i = 0; i < mesh.triangleCount(); i++) {
+		const Vector3f &v1 = mesh.positions[mesh.indices[i * 3]];
+		const Vector3f &v2 = mesh.positions[mesh.indices[i * 3 + 1]];
+		const Vector3f &v3 = mesh.positions[mesh.indices[i * 3 + 2]];
+		Vector3f faceNormal = (v2 - v1).cross(v3 - v1);
+		for (int j = 0; j < 3; j++) {
+			vertexNormals[this->objIndices[mesh.indices[i * 3 + j]]] += faceNormal;
+		}
+	}
+
+	for (unsigned i = 0; i < mesh.normals.size(); i++) {
+		Vector3f &normal = this->mesh.normals[i];
+		if (normal.x != 0 || normal.y != 0 || normal.z != 0) {
+			continue;
+		}
+		normal = vertexNormals[this->objIndices[i]];
+		if (normal.length() > 0) {
+			normal.normalize();
+		}
+	}
+}
+
+/**
+ * @brief build the chain of simplified meshes from the positions in the file
+ * 
+ * each level has about LOD_REDUCTION times the triangles of the previous one,
+ * the chain stops at LOD_MIN_TRIANGLES, at LOD_MAX_LEVELS or when no edge can be
+ * collapsed anymore, the vertices of each level are a subset of the mesh vertices
+ * and its triangles keep the color and the texture of the triangles they come from,
+ * the borders between materials are kept as seams until no edge can be collapsed
+ * without moving them
+ */
+void ObjLoader::buildLevels() {
+	this->levels.clear();
+	this->levelVertices.clear();
+	this->levelErrors.clear();
+	// the triangles with the same color and texture are a group whose outline the levels keep
+	std::map<std::tuple<uint32_t, const Texture*>, uint32_t> materials;
+	std::vector<uint32_t> groups(this->mesh.triangleCount());
+	for (unsigned i = 0; i < groups.size(); i++) {
+		const Color &color = this->mesh.colors[i];
+		uint32_t rgba = (uint32_t)color.r << 24 | color.g << 16 | color.b << 8 | color.a;
+		const Texture *texture = this->mesh.textures.empty() ? nullptr : this->mesh.textures[i].get();
+		groups[i] = materials.emplace(std::make_tuple(rgba, texture), materials.size()).first->second;
+	}
+	MeshSimplifier simplifier(this->objPositions, this->mesh.indices, groups);
+	std::vector<uint32_t> indices, sources;
+	// triangle of the mesh each triangle given to the simplifier comes from, and error of its input
+	std::vector<uint32_t> origins(this->mesh.triangleCount());
+	std::iota(origins.begin(), origins.end(), 0);
+	float baseError = 0;
+	bool grouped = true;
+	std::vector<uint32_t> levelVertex(this->mesh.positions.size());
+	unsigned triangles = this->mesh.triangleCount();
+	while (this->levels.size() < LOD_MAX_LEVELS && triangles * LOD_REDUCTION >= LOD_MIN_TRIANGLES) {
+		float error = baseError + simplifier.simplify(triangles * LOD_REDUCTION);
+		if (simplifier.getTriangleCount() == triangles) {
+			if (!grouped) {
+				break;
+			}
+			// the material borders stop the collapses, the coarsest levels go on without them
+			simplifier.getTriangles(indices, sources);
+			for (uint32_t &source : sources) {
+				source = origins[source];
+			}
+			origins.swap(sources);
+			simplifier = MeshSimplifier(this->objPositions, indices);
+			baseError = error;
+			grouped = false;
+			continue;
+		}
+		triangles = simplifier.getTriangleCount();
+		simplifier.getTriangles(indices, sources);
+		for (uint32_t &source : sources) {
+			source = origins[source];
+		}
+
+		// the used mesh vertices are renumbered in order
+		Mesh level;
+		std::vector<uint32_t> vertices;
+		std::fill(levelVertex.begin(), levelVertex.end(), UINT32_MAX);
+		for (uint32_t vertex : indices) {
+			if (levelVertex[vertex] == UINT32_MAX) {
+				levelVertex[vertex] = vertices.size();
+				vertices.push_back(vertex);
+			}
+			level.indices.push_back(levelVertex[vertex]);
+		}
+		level.positions.resize(vertices.size());
+		level.normals.resize(vertices.size());
+		level.uvs.resize(vertices.size());
+		for (unsigned i = 0; i < vertices.size(); i++) {
+			level.uvs[i] = this->mesh.uvs[vertices[i]];
+		}
+		for (uint32_t source : sources) {
+			level.colors.push_back(this->mesh.colors[source]);
+			if (!this->mesh.textures.empty()) {
+				level.textures.push_back(this->mesh.textures[source]);
+			}
+		}
+		this->levels.push_back(std::move(level));
+		this->levelVertices.push_back(std::move(vertices));
+		this->levelErrors.push_back(error);
+	}
+}
+
 void ObjLoader::shape_init() {
 	if (!objLoaded) {
 		throw std::runtime_error("ObjLoader::shape_init() called before ObjLoader::loadFile()");
 	}
-	this->triangles.clear();
-	this->colors.clear();
-	this->triangles.resize(this->objTriangles.size());
-	this->colors.resize(this->objTriangles.size());
-	for (unsigned int i = 0; i < this->objTriangles.size(); i++) {
-		this->triangles[i] = this->objTriangles[i];
-		this->triangles[i].applyTransform(this->rotationMatrix, this->size);
-		this->colors[i] = this->objColors[i];
-	}
+	this->transformMesh();
 }
 
 void ObjLoader::shape_update() {
-	if (!objLoaded) {
-		throw std::runtime_error("ObjLoader::update() called before ObjLoader::loadFile()");
+	// before a file is loaded the mesh is empty
+	this->transformMesh();
+}
+
+/**
+ * @brief scale and rotate the mesh vertices from their position in the file, each one once
+ * 
+ * normals are scaled by the inverse size to stay perpendicular to the surface,
+ * the face normals are computed again and the hierarchy over the triangles is
+ * built the first time then refit, the simplified levels copy their vertices
+ * from the mesh and have no hierarchy
+ */
+void ObjLoader::transformMesh() {
+	Mesh &mesh = this->mesh;
+	for (unsigned i = 0; i < mesh.positions.size(); i++) {
+		const Vector3f &normal = this->objNormals[i];
+		mesh.positions[i] = this->objPositions[i] * this->size;
+		mesh.normals[i] = normal.x != 0 || normal.y != 0 || normal.z != 0 ? normal / this->size : normal;
+	}
+	this->rotationMatrix.transformPoints(mesh.positions.data(), mesh.positions.data(), mesh.positions.size(), true);
+	this->rotationMatrix.transformDirections(mesh.normals.data(), mesh.normals.data(), mesh.normals.size());
+	for (unsigned i = 0; i < mesh.normals.size(); i++) {
+		Vector3f &normal = mesh.normals[i];
+		if (normal.x != 0 || normal.y != 0 || normal.z != 0) {
+			normal.normalize();
+		}
 	}
-	this->triangles.clear();
-	this->triangles.resize(this->objTriangles.size());
-	this->colors.clear();
-	this->colors.resize(this->objTriangles.size());
-	for (unsigned int i = 0; i < this->objTriangles.size(); i++) {
-		this->triangles[i] = this->objTriangles[i];
-		this->triangles[i].applyTransform(this->rotationMatrix, this->size);
-		this->colors[i] = this->objColors[i];
+	mesh.computeFaceNormals();
+	mesh.bvh.update(mesh.positions.data(), mesh.indices.data(), mesh.triangleCount());
+
+	// the levels read their vertices from the transformed mesh, the error grows with the largest scale
+	float scale = std::max({std::abs(this->size.x), std::abs(this->size.y), std::abs(this->size.z)});
+	for (unsigned i = 0; i < this->levels.size(); i++) {
+		Mesh &level = this->levels[i];
+		const std::vector<uint32_t> &vertices = this->levelVertices[i];
+		for (unsigned j = 0; j < vertices.size(); j++) {
+			level.positions[j] = mesh.positions[vertices[j]];
+			level.normals[j] = mesh.normals[vertices[j]];
+		}
+		level.computeFaceNormals();
+		level.error = this->levelErrors[i] * scale;
+	}
+}
+
+/**
+ * @brief expand the mesh into a list of independent triangles
+ * 
+ * @return std::vector<Triangle> a copy of each triangle, with its shared vertices duplicated
+ */
+std::vector<Triangle> ObjLoader::getTriangles() {
+	this->update();
+	std::vector<Triangle> triangles(this->mesh.triangleCount());
+	for (unsigned i = 0; i < triangles.size(); i++) {
+		triangles[i] = this->mesh.getTriangle(i);
+	}
+	return triangles;
+}
+
+std::vector<Color> ObjLoader::getColors() {
+	this->update();
+	return this->mesh.colors;
+}
+
+std::vector<std::shared_ptr<const Texture>> ObjLoader::getTextures() {
+	this->update();
+	return this->mesh.textures;
+}
+
+/**
+ * @brief get the loaded triangles as an indexed mesh, scaled and rotated
+ * 
+ * @return const Mesh* the mesh, empty if no file is loaded
+ */
+const Mesh *ObjLoader::getMesh() {
+	this->update();
+	return &this->mesh;
+}
+
+/**
+ * @brief get a simplified version of the mesh, scaled and rotated
+ * 
+ * @param level 0 for the mesh, then from the finest to the coarsest simplified mesh
+ * @return const Mesh* the mesh of the level, nullptr past the coarsest level
+ */
+const Mesh *ObjLoader::getLevel(unsigned level) {
+	this->update();
+	if (level == 0) {
+		return &this->mesh;
 	}
+	return level <= this->levels.size() ? &this->levels[level - 1] : nullptr;
 }
 
 /**
@@ -4,19 +4,22 @@ Shape::Shape(Vector3f size) :
 	size(size),
 	rotation(0, 0, 0), 
 	rotationMatrix(Matrix4::rotation(0, 0, 0)), 
-	updateNeeded(true) 
+	updateNeeded(true),
+	revision(0)
 {}
 
 Shape::Shape(const Shape& other) : 
 	size(other.size),
 	rotation(other.rotation), 
 	rotationMatrix(other.rotationMatrix),
-	updateNeeded(true) 
+	updateNeeded(true),
+	revision(0)
 {}
 
 Shape::~Shape() {
 	this->triangles.clear();
 	this->colors.clear();
+	this->textures.clear();
 }
 
 /**
@@ -120,6 +123,8 @@ void Shape::rotate(float x, float y, float z) {
 void Shape::init() {
 	this->shape_init();
 	this->updateNeeded = false;
+	this->revision++;
+	this->computeBounds();
 }
 
 /**
@@ -128,7 +133,67 @@ void Shape::init() {
  */
 void Shape::update() {
 	if (!this->updateNeeded)
-		return
+		return;
 	this->shape_update();
 	this->updateNeeded = false;
+	this->revision++;
+	this->computeBounds();
+}
+
+/**
+ * @brief get the bounding volumes of the shape, they follow its size and rotation
+ * 
+ * @return const ShapeBounds& the bounding box and sphere in shape space
+ */
+const ShapeBounds &Shape::getBounds() {
+	this->update();
+	return this->bounds;
+}
+
+/**
+ * @brief get the revision of the triangles, it changes each time they are updated or recolored
+ * 
+ * @return unsigned a counter to compare with the revision of a copy of the triangles
+ */
+unsigned Shape::getRevision() {
+	this->update();
+	return this->revision;
+}
+
+/**
+ * @brief compute the bounding box and sphere of the mesh vertices, or of the triangles
+ * 
+ */
+void Shape::computeBounds() {
+	std::vector<Vector3f> triangleVertices;
+	const Vector3f *points = nullptr;
+	size_t count = 0;
+	const Mesh *mesh = this->getMesh();
+	if (mesh) {
+		points = mesh->positions.data();
+		count = mesh->positions.size();
+	} else {
+		for (const Triangle &triangle : this->triangles) {
+			triangleVertices.insert(triangleVertices.end(), {triangle.v1, triangle.v2, triangle.v3});
+		}
+		points = triangleVertices.data();
+		count = triangleVertices.size();
+	}
+
+	ShapeBounds &bounds = this->bounds;
+	bounds = ShapeBounds();
+	if (count == 0) {
+		return;
+	}
+	bounds.min = bounds.max = points[0];
+	for (size_t i = 1; i < count; i++) {
+		bounds.min = Vector3f(std::min(bounds.min.x, points[i].x), std::min(bounds.min.y, points[i].y), std::min(bounds.min.z, points[i].z));
+		bounds.max = Vector3f(std::max(bounds.max.x, points[i].x), std::max(bounds.max.y, points[i].y), std::max(bounds.max.z, points[i].z));
+	}
+	bounds.center = (bounds.min + bounds.max) / 2.0f;
+	float radius = 0;
+	for (size_t i = 0; i < count; i++) {
+		radius = std::max(radius, (points[i] - bounds.center).sqareLength());
+	}
+	bounds.radius = std::sqrt(radius);
 }
\ No newline at end of file
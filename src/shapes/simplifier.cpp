@@ -0,0 +1,528 @@
+#include "shapes/simplifier.hpp"
+
+/**
+ * @brief add the plane of a triangle to the quadric
+ * 
+ * @param normal the normal of the triangle, (v2 - v1) x (v3 - v1)
+ * @param point a vertex of the triangle
+ * @param area the weight of the plane
+ */
+void MeshSimplifier::Quadric::addPlane(const Vector3f &normal, const Vector3f &point, double area) {
+	double length = std::sqrt((double)normal.x * normal.x + (double)normal.y * normal.y + (double)normal.z * normal.z);
+	if (length == 0) {
+		return;
+	}
+	double a = normal.x / length, b = normal.y / length, c = normal.z / length;
+	double d = -(a * point.x + b * point.y + c * point.z);
+	this->a2 += area * a * a;
+	this->ab += area * a * b;
+	this->ac += area * a * c;
+	this->ad += area * a * d;
+	this->b2 += area * b * b;
+	this->bc += area * b * c;
+	this->bd += area * b * d;
+	this->c2 += area * c * c;
+	this->cd += area * c * d;
+	this->d2 += area * d * d;
+	this->area += area;
+}
+
+/**
+ * @brief merge the planes of another quadric into this one
+ * 
+ * @param other the quadric to add
+ */
+void MeshSimplifier::Quadric::add(const Quadric &other) {
+	this->a2 += other.a2;
+	this->ab += other.ab;
+	this->ac += other.ac;
+	this->ad += other.ad;
+	this->b2 += other.b2;
+	this->bc += other.bc;
+	this->bd += other.bd;
+	this->c2 += other.c2;
+	this->cd += other.cd;
+	this->d2 += other.d2;
+	this->area += other.area;
+}
+
+/**
+ * @brief root mean square distance of a point to the planes of the quadric, weighted by their area
+ * 
+ * @param point the point to measure
+ * @return double the distance, 0 for an empty quadric
+ */
+double MeshSimplifier::Quadric::distance(const Vector3f &point) const {
+	if (this->area <= 0) {
+		return 0;
+	}
+	double x = point.x, y = point.y, z = point.z;
+	double squared =
+		this->a2 * x * x + 2 * this->ab * x * y + 2 * this->ac * x * z + 2 * this->ad * x +
+		this->b2 * y * y + 2 * this->bc * y * z + 2 * this->bd * y +
+		this->c2 * z * z + 2 * this->cd * z +
+		this->d2;
+	return std::sqrt(std::max(0.0, squared / this->area));
+}
+
+/**
+ * @brief prepare the simplification of a mesh
+ * 
+ * @param positions the position of each vertex
+ * @param indices 3 vertex indices per triangle
+ * @param groups the group of each triangle, the borders between groups are kept, empty for a single group
+ */
+MeshSimplifier::MeshSimplifier(const std::vector<Vector3f> &positions, const std::vector<uint32_t> &indices, const std::vector<uint32_t> &groups) :
+	positions(positions),
+	indices(indices),
+	groups(groups),
+	triangleCount(indices.size() / 3),
+	error(0)
+{
+	this->removedTriangles.assign(this->triangleCount, 0);
+	this->removedVertices.assign(positions.size(), 0);
+	this->versions.assign(positions.size(), 0);
+	this->classifyVertices();
+	this->vertexTriangles.resize(positions.size());
+	for (unsigned i = 0; i < this->triangleCount * 3; i++) {
+		this->vertexTriangles[this->welded[indices[i]]].push_back(i / 3);
+	}
+	this->computeQuadrics();
+	for (uint32_t vertex = 0; vertex < positions.size(); vertex++) {
+		if (this->welded[vertex] == vertex) {
+			this->findCollapse(vertex);
+		}
+	}
+}
+
+/**
+ * @brief collapse edges until the mesh has a number of triangles or no edge can be collapsed
+ * 
+ * @param triangles the number of triangles to reach
+ * @return float the error of the simplified mesh: the largest distance of a remaining position
+ * to the planes of the original triangles merged into it
+ */
+float MeshSimplifier::simplify(unsigned triangles) {
+	while (this->triangleCount > triangles && !this->queue.empty()) {
+		Collapse best = this->queue.top();
+		this->queue.pop();
+		if (this->removedVertices[best.from] || best.version != this->versions[best.from]) {
+			continue;
+		}
+		if (this->removedVertices[best.to] || !this->isValid(best.from, best.to)) {
+			// the neighborhood changed since the collapse was found
+			this->findCollapse(best.from);
+			continue;
+		}
+		this->error = std::max(this->error, best.cost);
+		this->collapse(best.from, best.to);
+	}
+	return this->error;
+}
+
+/**
+ * @brief get the number of remaining triangles
+ * 
+ * @return unsigned the triangles not removed by a collapse
+ */
+unsigned MeshSimplifier::getTriangleCount() const {
+	return this->triangleCount;
+}
+
+/**
+ * @brief get the error of the simplified mesh
+ * 
+ * @return float the largest cost of the collapses so far, in the unit of the positions
+ */
+float MeshSimplifier::getError() const {
+	return this->error;
+}
+
+/**
+ * @brief copy the remaining triangles
+ * 
+ * @param indices filled with 3 vertex indices per remaining triangle, indices of the original vertices
+ * @param sources filled with the index in the original mesh of each remaining triangle
+ */
+void MeshSimplifier::getTriangles(std::vector<uint32_t> &indices, std::vector<uint32_t> &sources) const {
+	indices.clear();
+	sources.clear();
+	for (uint32_t triangle = 0; triangle < this->removedTriangles.size(); triangle++) {
+		if (this->removedTriangles[triangle]) {
+			continue;
+		}
+		indices.insert(indices.end(), this->indices.begin() + triangle * 3, this->indices.begin() + triangle * 3 + 3);
+		sources.push_back(triangle);
+	}
+}
+
+namespace {
+
+/**
+ * @brief key of a position made of the bits of its coordinates
+ * 
+ * @param position the position
+ * @return uint64_t a hash of the exact coordinates
+ */
+uint64_t positionKey(const Vector3f &position) {
+	uint32_t bits[3];
+	std::memcpy(&bits[0], &position.x, sizeof(float));
+	std::memcpy(&bits[1], &position.y, sizeof(float));
+	std::memcpy(&bits[2], &position.z, sizeof(float));
+	return ((uint64_t)bits[0] * 0x9e3779b97f4a7c15ull) ^ ((uint64_t)bits[1] * 0xc2b2ae3d27d4eb4full) ^ bits[2];
+}
+
+/**
+ * @brief an edge between 2 positions and the triangles using it
+ * 
+ */
+struct WeldedEdge {
+	unsigned triangles = 0;
+	// wedges of the 2 positions in the first triangle of the edge
+	uint64_t first[2];
+	// a triangle uses other wedges than the first one at a position of the edge
+	bool seam = false;
+};
+
+}
+
+/**
+ * @brief identify a corner of a triangle by its vertex and the group of the triangle
+ * 
+ * the corners with the same wedge are on the same side of the seams
+ * 
+ * @param triangle the triangle
+ * @param corner the corner, from 0 to 2
+ * @return uint64_t the group in the high bits and the vertex in the low bits
+ */
+uint64_t MeshSimplifier::getWedge(uint32_t triangle, unsigned corner) const {
+	uint64_t group = this->groups.empty() ? 0 : this->groups[triangle];
+	return group << 32 | this->indices[triangle * 3 + corner];
+}
+
+/**
+ * @brief weld the vertices by position and find the SimplifierVertex of each position
+ * 
+ * an edge used by 2 triangles with different wedges at one of its positions is a seam,
+ * an edge used by a single triangle is a border, the positions with 2 seam edges and 2
+ * wedges, or with 2 border edges and a single wedge, move along their seam or border,
+ * the other positions on seams or borders are their corners and are locked
+ */
+void MeshSimplifier::classifyVertices() {
+	this->welded.resize(this->positions.size());
+	std::unordered_multimap<uint64_t, uint32_t> vertices;
+	for (uint32_t vertex = 0; vertex < this->positions.size(); vertex++) {
+		const Vector3f &position = this->positions[vertex];
+		this->welded[vertex] = vertex;
+		auto range = vertices.equal_range(positionKey(position));
+		for (auto it = range.first; it != range.second; it++) {
+			const Vector3f &other = this->positions[it->second];
+			if (other.x == position.x && other.y == position.y && other.z == position.z) {
+				this->welded[vertex] = it->second;
+				break;
+			}
+		}
+		if (this->welded[vertex] == vertex) {
+			vertices.emplace(positionKey(position), vertex);
+		}
+	}
+
+	// wedges of each position counted from their triangles, a position keeps the first 2
+	std::vector<unsigned> wedges(this->positions.size(), 0);
+	std::vector<uint64_t> firstWedges(this->positions.size() * 2, UINT64_MAX);
+	std::vector<char> locked(this->positions.size(), 0);
+	std::unordered_map<uint64_t, WeldedEdge> edges;
+	for (unsigned triangle = 0; triangle < this->triangleCount; triangle++) {
+		for (unsigned corner = 0; corner < 3; corner++) {
+			uint64_t wedge = this->getWedge(triangle, corner);
+			uint32_t position = this->welded[this->indices[triangle * 3 + corner]];
+			uint64_t *known = &firstWedges[position * 2];
+			if (known[0] != wedge && known[1] != wedge) {
+				if (wedges[position] < 2) {
+					known[wedges[position]] = wedge;
+				}
+				wedges[position]++;
+			}
+
+			uint64_t next = this->getWedge(triangle, (corner + 1) % 3);
+			uint32_t a = position, b = this->welded[this->indices[triangle * 3 + (corner + 1) % 3]];
+			if (a == b) {
+				locked[a] = 1;
+				continue;
+			}
+			uint64_t ends[2] = {wedge, next};
+			if (a > b) {
+				std::swap(a, b);
+				std::swap(ends[0], ends[1]);
+			}
+			WeldedEdge &edge = edges[(uint64_t)a << 32 | b];
+			if (edge.triangles++ == 0) {
+				std::copy(ends, ends + 2, edge.first);
+			} else if (edge.first[0] != ends[0] || edge.first[1] != ends[1]) {
+				edge.seam = true;
+			}
+		}
+	}
+
+	std::vector<unsigned> borderEdges(this->positions.size(), 0), seamEdges(this->positions.size(), 0);
+	for (const std::pair<const uint64_t, WeldedEdge> &entry : edges) {
+		uint32_t ends[2] = {(uint32_t)(entry.first >> 32), (uint32_t)(entry.first & 0xffffffff)};
+		const WeldedEdge &edge = entry.second;
+		for (uint32_t end : ends) {
+			if (edge.triangles > 2) {
+				locked[end] = 1;
+			} else if (edge.triangles == 1) {
+				borderEdges[end]++;
+			} else if (edge.seam) {
+				seamEdges[end]++;
+			}
+		}
+	}
+
+	this->kinds.assign(this->positions.size(), SIMPLIFIER_LOCKED);
+	for (uint32_t position = 0; position < this->positions.size(); position++) {
+		if (this->welded[position] != position || locked[position]) {
+			continue;
+		}
+		if (wedges[position] == 1 && borderEdges[position] == 0 && seamEdges[position] == 0) {
+			this->kinds[position] = SIMPLIFIER_MANIFOLD;
+		} else if (wedges[position] == 1 && borderEdges[position] == 2 && seamEdges[position] == 0) {
+			this->kinds[position] = SIMPLIFIER_BORDER;
+		} else if (wedges[position] == 2 && borderEdges[position] == 0 && seamEdges[position] == 2) {
+			this->kinds[position] = SIMPLIFIER_SEAM;
+		}
+	}
+}
+
+/**
+ * @brief sum the planes of the triangles of each position
+ * 
+ * the borders and the seams also add the plane through each of their edges
+ * perpendicular to its triangle, so the collapses along them keep their shape
+ */
+void MeshSimplifier::computeQuadrics() {
+	this->quadrics.assign(this->positions.size(), Quadric());
+	for (unsigned triangle = 0; triangle < this->triangleCount; triangle++) {
+		uint32_t corners[3];
+		for (unsigned corner = 0; corner < 3; corner++) {
+			corners[corner] = this->welded[this->indices[triangle * 3 + corner]];
+		}
+		const Vector3f &v1 = this->positions[corners[0]];
+		Vector3f normal = (this->positions[corners[1]] - v1).cross(this->positions[corners[2]] - v1);
+		double area = normal.length() / 2;
+		for (unsigned corner = 0; corner < 3; corner++) {
+			this->quadrics[corners[corner]].addPlane(normal, v1, area);
+		}
+
+		for (unsigned corner = 0; corner < 3; corner++) {
+			uint32_t a = corners[corner], b = corners[(corner + 1) % 3];
+			if (this->kinds[a] == SIMPLIFIER_MANIFOLD || this->kinds[b] == SIMPLIFIER_MANIFOLD) {
+				continue;
+			}
+			// the edge is on a border or a seam if a single triangle, or a single one with these wedges, uses it
+			uint64_t wedgeA = this->getWedge(triangle, corner), wedgeB = this->getWedge(triangle, (corner + 1) % 3);
+			unsigned triangles = 0;
+			for (uint32_t other : this->vertexTriangles[a]) {
+				bool hasA = false, hasB = false;
+				for (unsigned i = 0; i < 3; i++) {
+					hasA |= this->getWedge(other, i) == wedgeA;
+					hasB |= this->getWedge(other, i) == wedgeB;
+				}
+				triangles += hasA && hasB;
+			}
+			if (triangles != 1) {
+				continue;
+			}
+			Vector3f edge = this->positions[b] - this->positions[a];
+			Vector3f side = edge.cross(normal);
+			double weight = edge.dot(edge);
+			this->quadrics[a].addPlane(side, this->positions[a], weight);
+			this->quadrics[b].addPlane(side, this->positions[a], weight);
+		}
+	}
+}
+
+/**
+ * @brief error of moving a position onto another one
+ * 
+ * @param from the position to move
+ * @param to the position it is moved onto
+ * @return float the distance of the kept position to the planes of both positions
+ */
+float MeshSimplifier::collapseCost(uint32_t from, uint32_t to) const {
+	Quadric merged = this->quadrics[from];
+	merged.add(this->quadrics[to]);
+	return merged.distance(this->positions[to]);
+}
+
+/**
+ * @brief list the positions sharing a triangle with a position
+ * 
+ * @param vertex the position
+ * @param neighbors filled with its neighbors, each one once
+ */
+void MeshSimplifier::getNeighbors(uint32_t vertex, std::vector<uint32_t> &neighbors) const {
+	neighbors.clear();
+	for (uint32_t triangle : this->vertexTriangles[vertex]) {
+		if (this->removedTriangles[triangle]) {
+			continue;
+		}
+		for (unsigned corner = 0; corner < 3; corner++) {
+			uint32_t other = this->welded[this->indices[triangle * 3 + corner]];
+			if (other != vertex && std::find(neighbors.begin(), neighbors.end(), other) == neighbors.end()) {
+				neighbors.push_back(other);
+			}
+		}
+	}
+}
+
+/**
+ * @brief check if a position can be moved onto a neighbor without damaging the surface
+ * 
+ * each wedge of the moved position must find the vertex it becomes on a triangle of
+ * their edge, the borders and the seams only move along themselves, the triangles kept
+ * around the moved position must not flip or become degenerate, and the 2 positions must
+ * only share the neighbors of the triangles on their edge, else the collapse would join
+ * 2 sheets of the surface
+ * 
+ * @param from the position to move
+ * @param to the position it is moved onto
+ * @return bool true if the collapse keeps a manifold surface facing the same way,
+ * vertexMap then tells the vertex of the kept position each vertex of the moved one becomes
+ */
+bool MeshSimplifier::isValid(uint32_t from, uint32_t to) {
+	SimplifierVertex kind = (SimplifierVertex)this->kinds[from];
+	if (kind == SIMPLIFIER_LOCKED) {
+		return false;
+	}
+	std::vector<std::pair<uint32_t, uint32_t>> &vertexMap = this->vertexMap;
+	vertexMap.clear();
+	// wedges of the moved position found on the triangles of the edge
+	uint64_t sides[2];
+	unsigned sideCount = 0;
+	unsigned shared = 0;
+	for (uint32_t triangle : this->vertexTriangles[from]) {
+		if (this->removedTriangles[triangle]) {
+			continue;
+		}
+		const uint32_t *corners = &this->indices[triangle * 3];
+		int fromCorner = 0, toCorner = -1;
+		for (int corner = 0; corner < 3; corner++) {
+			uint32_t position = this->welded[corners[corner]];
+			fromCorner = position == from ? corner : fromCorner;
+			toCorner = position == to ? corner : toCorner;
+		}
+		if (toCorner >= 0) {
+			shared++;
+			uint64_t wedge = this->getWedge(triangle, fromCorner);
+			if (std::find(sides, sides + sideCount, wedge) == sides + sideCount) {
+				if (sideCount == 2) {
+					return false;
+				}
+				sides[sideCount++] = wedge;
+			}
+			auto known = std::find_if(vertexMap.begin(), vertexMap.end(), [corners, fromCorner](const std::pair<uint32_t, uint32_t> &entry) {
+				return entry.first == corners[fromCorner];
+			});
+			if (known == vertexMap.end()) {
+				vertexMap.push_back({corners[fromCorner], corners[toCorner]});
+			} else if (known->second != corners[toCorner]) {
+				return false;
+			}
+			continue;
+		}
+		Vector3f before[3], after[3];
+		for (unsigned corner = 0; corner < 3; corner++) {
+			before[corner] = this->positions[this->welded[corners[corner]]];
+			after[corner] = (int)corner == fromCorner ? this->positions[to] : before[corner];
+		}
+		Vector3f normalBefore = (before[1] - before[0]).cross(before[2] - before[0]);
+		Vector3f normalAfter = (after[1] - after[0]).cross(after[2] - after[0]);
+		if (normalBefore.dot(normalAfter) <= 0) {
+			return false;
+		}
+	}
+	// a border moves along a border edge, a seam along a seam edge, where each of its 2 wedges is on a side
+	unsigned expected = kind == SIMPLIFIER_BORDER ? 1 : 2;
+	unsigned wedges = kind == SIMPLIFIER_SEAM ? 2 : 1;
+	if (shared != expected || sideCount != wedges) {
+		return false;
+	}
+
+	this->getNeighbors(from, this->neighbors);
+	this->getNeighbors(to, this->otherNeighbors);
+	unsigned common = 0;
+	for (uint32_t neighbor : this->neighbors) {
+		common += std::find(this->otherNeighbors.begin(), this->otherNeighbors.end(), neighbor) != this->otherNeighbors.end();
+	}
+	return common == shared;
+}
+
+/**
+ * @brief queue the cheapest valid collapse of a position onto one of its neighbors
+ * 
+ * @param vertex the position to move, nothing is queued if it is locked or no collapse is valid
+ */
+void MeshSimplifier::findCollapse(uint32_t vertex) {
+	this->versions[vertex]++;
+	if (this->kinds[vertex] == SIMPLIFIER_LOCKED || this->removedVertices[vertex]) {
+		return;
+	}
+	std::vector<std::pair<float, uint32_t>> candidates;
+	std::vector<uint32_t> neighbors;
+	this->getNeighbors(vertex, neighbors);
+	for (uint32_t neighbor : neighbors) {
+		candidates.push_back({this->collapseCost(vertex, neighbor), neighbor});
+	}
+	std::sort(candidates.begin(), candidates.end());
+	for (const std::pair<float, uint32_t> &candidate : candidates) {
+		if (this->isValid(vertex, candidate.second)) {
+			this->queue.push({candidate.first, vertex, candidate.second, this->versions[vertex]});
+			return;
+		}
+	}
+}
+
+/**
+ * @brief move a position onto a neighbor, remove the triangles of their edge and update the collapses around it
+ * 
+ * @param from the position to remove
+ * @param to the position it is moved onto, vertexMap must hold the result of isValid(from, to)
+ */
+void MeshSimplifier::collapse(uint32_t from, uint32_t to) {
+	for (uint32_t triangle : this->vertexTriangles[from]) {
+		if (this->removedTriangles[triangle]) {
+			continue;
+		}
+		uint32_t *corners = &this->indices[triangle * 3];
+		bool onEdge = false;
+		for (unsigned corner = 0; corner < 3; corner++) {
+			onEdge |= this->welded[corners[corner]] == to;
+		}
+		if (onEdge) {
+			this->removedTriangles[triangle] = 1;
+			this->triangleCount--;
+			continue;
+		}
+		for (unsigned corner = 0; corner < 3; corner++) {
+			for (const std::pair<uint32_t, uint32_t> &entry : this->vertexMap) {
+				if (corners[corner] == entry.first) {
+					corners[corner] = entry.second;
+					break;
+				}
+			}
+		}
+		this->vertexTriangles[to].push_back(triangle);
+	}
+	std::vector<uint32_t>().swap(this->vertexTriangles[from]);
+	this->quadrics[to].add(this->quadrics[from]);
+	this->removedVertices[from] = 1;
+	this->versions[from]++;
+
+	std::vector<uint32_t> around;
+	this->getNeighbors(to, around);
+	around.push_back(to);
+	for (uint32_t vertex : around) {
+		this->findCollapse(vertex);
+	}
+}
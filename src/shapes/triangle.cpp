@@ -13,7 +13,12 @@ Triangle::Triangle(const Triangle& other) :
 	v2(other.v2),
 	v3(other.v3),
 	normal(other.normal)
-{}
+{
+	for (int i = 0; i < 3; i++) {
+		this->vertexNormals[i] = other.vertexNormals[i];
+		this->uvs[i] = other.uvs[i];
+	}
+}
 
 /**
  * @brief compute the triangle normal
@@ -67,6 +72,23 @@ Vector3f Triangle::getNormal() const {
 	return this->normal;
 }
 
+/**
+ * @brief get the normal of a vertex for smooth shading
+ * 
+ * @param index the vertex index
+ * @return Vector3f the vertex normal, or the face normal if the vertex has none
+ */
+Vector3f Triangle::getVertexNormal(unsigned index) const {
+	if (index > 2) {
+		throw std::runtime_error("Index out of range");
+	}
+	const Vector3f &normal = this->vertexNormals[index];
+	if (normal.x == 0 && normal.y == 0 && normal.z == 0) {
+		return this->normal;
+	}
+	return normal;
+}
+
 /**
  * @brief get "left" and "right" point of plane triangle intersection
  * 
@@ -127,8 +149,49 @@ std::pair<int, int> Triangle::getDistancesToPlane(
  * @param size the scaling factor to apply on each axis
  */
 void Triangle::applyTransform(const Matrix4 &rotation, const Vector3f &size) {
-	this->v1 = rotation * (this->v1 * size);
-	this->v2 = rotation * (this->v2 * size);
-	this->v3 = rotation * (this->v3 * size);
-	this->normal = rotation * this->normal;
+	Triangle::applyTransform(this, 1, rotation, size);
+}
+
+/**
+ * @brief apply a rotation and a scaling to several triangles at once
+ * 
+ * the vertices and the normals of all the triangles are gathered so the matrix
+ * transforms them in two batches
+ * 
+ * @param triangles the triangles to transform
+ * @param count the number of triangles
+ * @param rotation the rotation matrix to apply, it must be affine
+ * @param size the scaling factor to apply on each axis
+ */
+void Triangle::applyTransform(Triangle *triangles, size_t count, const Matrix4 &rotation, const Vector3f &size) {
+	// each triangle has 3 vertices, then its face normal and its 3 vertex normals
+	std::vector<Vector3f> points(count * 3), directions(count * 4);
+	for (size_t i = 0; i < count; i++) {
+		const Triangle &t = triangles[i];
+		points[i * 3] = t.v1 * size;
+		points[i * 3 + 1] = t.v2 * size;
+		points[i * 3 + 2] = t.v3 * size;
+		directions[i * 4] = t.normal;
+		for (int j = 0; j < 3; j++) {
+			// normals are scaled by the inverse size to stay perpendicular to the surface
+			directions[i * 4 + 1 + j] = t.vertexNormals[j] / size;
+		}
+	}
+	rotation.transformPoints(points.data(), points.data(), points.size(), true);
+	rotation.transformDirections(directions.data(), directions.data(), directions.size());
+
+	for (size_t i = 0; i < count; i++) {
+		Triangle &t = triangles[i];
+		t.v1 = points[i * 3];
+		t.v2 = points[i * 3 + 1];
+		t.v3 = points[i * 3 + 2];
+		t.normal = directions[i * 4];
+		for (int j = 0; j < 3; j++) {
+			Vector3f &normal = t.vertexNormals[j];
+			if (normal.x != 0 || normal.y != 0 || normal.z != 0) {
+				normal = directions[i * 4 + 1 + j];
+				normal.normalize();
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "shapes/objloader.hpp"
+#include "scene/scene.hpp"
+
+#define WIDTH 640
+#define HEIGHT 480
+#define FRAMES 8
+
+/**
+ * @brief color and depth buffers of a rendered frame, with the padding of the rows removed
+ * 
+ */
+struct FrameCapture {
+	std::vector<Color> colors;
+	std::vector<float> depths;
+};
+
+/**
+ * @brief render a frame of the rotating shape and copy its buffers
+ * 
+ * @param scene the scene, its modes already set
+ * @param shape the shape to draw
+ * @param rotation the rotation of the shape around the vertical axis
+ * @return FrameCapture the rendered frame
+ */
+FrameCapture renderFrame(Scene &scene, Shape &shape, float rotation) {
+	scene.clear();
+	scene.pushMatrix();
+	scene.rotate(0, rotation, 0);
+	scene.drawShape(&shape);
+	scene.popMatrix();
+	scene.render();
+
+	const Framebuffer &framebuffer = scene.getFramebuffer();
+	FrameCapture capture;
+	for (unsigned y = 0; y < HEIGHT; y++) {
+		for (unsigned x = 0; x < WIDTH; x++) {
+			capture.colors.push_back(framebuffer.getPixel(x, y));
+			capture.depths.push_back(framebuffer.getDepth(x, y));
+		}
+	}
+	return capture;
+}
+
+/**
+ * @brief count the pixels whose color or depth differ between 2 frames
+ * 
+ * @return unsigned the number of differing pixels
+ */
+unsigned countDifferences(const FrameCapture &a, const FrameCapture &b) {
+	unsigned differences = 0;
+	for (size_t i = 0; i < a.colors.size(); i++) {
+		const Color &colorA = a.colors[i];
+		const Color &colorB = b.colors[i];
+		bool sameColor = colorA.r == colorB.r && colorA.g == colorB.g && colorA.b == colorB.b && colorA.a == colorB.a;
+		if (!sameColor || a.depths[i] != b.depths[i]) {
+			differences++;
+		}
+	}
+	return differences;
+}
+
+/**
+ * @brief check the simd raster kernels draw the same pixels as the scalar ones
+ * 
+ * the teapot is rendered from several angles, flat and Gouraud shaded, once with
+ * each kernel, and the color and depth buffers must be identical
+ * 
+ * usage: simdReference <obj file>
+ */
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		std::cout << "usage: simdReference <obj file>" << std::endl;
+		return 1;
+	}
+
+	ObjLoader loader(Vector3f(1.2, 1.2, 1.2));
+	loader.loadObjFile(argv[1]);
+	if (!loader.isLoaded()) {
+		std::cout << "Error loading file: " << loader.getErrorMessage() << std::endl;
+		return 1;
+	}
+
+	Scene scene(WIDTH, HEIGHT, 90, 1, 1000);
+	scene.setCamera(Vector3f(0, 4, -3), Vector3f(0, 0, 0), Vector3f(0, 1, 0));
+
+	bool failed = false;
+	for (bool gouraud : {false, true}) {
+		scene.gouraud = gouraud;
+		for (int frame = 0; frame < FRAMES; frame++) {
+			float rotation = frame * 0.8f;
+			scene.simd = false;
+			FrameCapture scalar = renderFrame(scene, loader, rotation);
+			scene.simd = true;
+			FrameCapture simd = renderFrame(scene, loader, rotation);
+
+			unsigned differences = countDifferences(scalar, simd);
+			if (differences > 0) {
+				std::cout << (gouraud ? "Gouraud" : "flat") << " frame " << frame << ": " << differences << " pixels differ" << std::endl;
+				failed = true;
+			}
+		}
+	}
+
+	std::cout << Rasterizer::simdName() << (failed ? " differs from" : " matches") << " the scalar kernels" << std::endl;
+	return failed ? 1 : 0;
+}